@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// arena.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the string arena.  See arena.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "arena.h"
+
+StringArena::StringArena(size_t chunkSize)
+{
+	m_next = NULL;
+	m_left = 0;
+	m_chunkSize = chunkSize;
+	m_firstChunk = 0;
+	m_used = 0;
+	m_allocated = 0;
+}
+
+StringArena::~StringArena()
+{
+	for (size_t i = 0; i < m_chunks.size(); i++)
+		delete [] m_chunks[i];
+}
+
+void StringArena::Clear()
+{
+	if (m_chunks.size() == 0)
+		return;
+	for (size_t i = 1; i < m_chunks.size(); i++)
+		delete [] m_chunks[i];
+	m_chunks.resize(1);
+
+	m_next = m_chunks[0];
+	m_left = m_firstChunk;
+	m_used = 0;
+	m_allocated = m_firstChunk;
+}
+
+// Stores a string that doesn't fit in what is left of the current chunk.  A
+// long one gets a chunk of its own, and the current chunk stays current.
+// Otherwise the rest of the current chunk is wasted, but that is less than
+// the string, so less than a quarter of a chunk.
+std::string_view StringArena::StoreInNewChunk(const char* data, size_t length)
+{
+	if (length > m_chunkSize / 4)
+	{
+		char* copy = new char[length];
+		memcpy(copy, data, length);
+		if (m_chunks.size() == 0)
+			m_firstChunk = length;
+		m_chunks.push_back(copy);
+		m_used += length;
+		m_allocated += length;
+		return std::string_view(copy, length);
+	}
+	NewChunk(length);
+	return Store(data, length);
+}
+
+// Starts a new chunk with room for at least length bytes.
+void StringArena::NewChunk(size_t length)
+{
+	// the first chunk starts small, so that a dictionary per thread doesn't
+	// cost a full chunk each when it holds only a few words
+	size_t size = m_chunks.size() == 0 ? m_chunkSize / 16 : m_chunkSize;
+	if (size < length)
+		size = length;
+
+	if (m_chunks.size() == 0)
+		m_firstChunk = size;
+	m_chunks.push_back(new char[size]);
+	m_next = m_chunks.back();
+	m_left = size;
+	m_allocated += size;
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// arena.h
+///////////////////////////////////////////////////////////////////////////////
+// Bump allocated storage for strings that live as long as the program does,
+// such as the words of the term dictionary and the names of the documents.
+//
+// Strings are copied one after another into large chunks, so storing a
+// million words takes a handful of allocations instead of a million, and the
+// words sit next to each other in memory.  A string longer than a quarter
+// of a chunk gets a chunk of its own, so that at most a quarter of any chunk
+// is left unused.  Nothing is freed until the arena is destroyed or cleared.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <string.h>
+#include <string_view>
+#include <vector>
+
+class StringArena
+{
+public:
+	StringArena(size_t chunkSize = 1 << 20);
+	~StringArena();
+
+	// Copies data[0..length) into the arena and returns the copy, which
+	// stays valid as long as the arena does.
+	std::string_view Store(const char* data, size_t length)
+	{
+		if (length == 0)
+			return std::string_view();
+		if (length > m_left)
+			return StoreInNewChunk(data, length);
+		char* copy = m_next;
+		memcpy(copy, data, length);
+		m_next += length;
+		m_left -= length;
+		m_used += length;
+		return std::string_view(copy, length);
+	}
+
+	std::string_view Store(std::string_view text)
+		{ return Store(text.data(), text.size()); }
+
+	// Forgets every string stored, keeping the first chunk for the next ones.
+	void Clear();
+
+	// Bytes of strings stored, and bytes allocated for them.
+	size_t Used() const { return m_used; }
+	size_t Allocated() const { return m_allocated; }
+	size_t Chunks() const { return m_chunks.size(); }
+
+private:
+	std::string_view StoreInNewChunk(const char* data, size_t length);
+	void NewChunk(size_t length);
+
+	std::vector<char*> m_chunks;
+	size_t m_firstChunk;	// bytes in m_chunks[0]
+	char* m_next;
+	size_t m_left;			// bytes free after m_next
+	size_t m_chunkSize;
+	size_t m_used;
+	size_t m_allocated;
+
+	// not copyable: the string_views handed out point into the chunks
+	StringArena(const StringArena&);
+	StringArena& operator=(const StringArena&);
+};
+
+#endif
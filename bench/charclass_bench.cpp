@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////////
+// charclass_bench.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Micro-benchmark for the character kernels in charclass.cpp.
+//
+// Times splitting a file into tokens and lower casing/stripping them, first
+// the way spasmifytext used to (istream >> string, then ToLower() and 
+// RemovePunct()), and then with the Tokenizer using each set of kernels the
+// CPU supports.  Then, with the best kernels, times normalizing the tokens 
+// as UTF-8, which is what every policy but legacy does.  Prints the 
+// throughput of each in bytes per second.
+//
+// Build from the top of the tree with
+//     g++ -O2 -std=c++17 -Wall -I. -o charclass_bench
+//         bench/charclass_bench.cpp charclass.cpp tokenizer.cpp normalize.cpp
+//         unicode.cpp
+// and run it as "charclass_bench [FILE]".  Without a file it times 64MB of 
+// generated text.
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "charclass.h"
+#include "tokenizer.h"
+#include "normalize.h"
+using namespace std;
+
+// The original scalar path from spasmifytext.cpp.
+static void OldToLower(string& str)
+{
+	for (size_t i = 0; i < str.length(); i++)
+		str[i] = tolower(str[i]);
+}
+
+static void OldRemovePunct(string& str)
+{
+	for (size_t i = 0; i < str.length(); i++)
+	{
+		if (!isalpha(str[i]))
+			str.erase(i,10);
+	}
+}
+
+// Writes size bytes of text that looks roughly like prose: mostly lower case
+// words, some capitalized, some with punctuation stuck to them, and a few 
+// with an accented letter.
+static void Generate(const char* path, size_t size)
+{
+	ofstream out(path);
+	unsigned int seed = 12345;
+	size_t written = 0;
+	while (written < size)
+	{
+		seed = seed * 1103515245 + 12345;
+		string word;
+		int length = 1 + (seed >> 16) % 10;
+		for (int i = 0; i < length; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			word += (char) ('a' + (seed >> 16) % 26);
+		}
+		if (seed % 7 == 0)
+			word[0] = toupper(word[0]);
+		if (seed % 11 == 0)
+			word += ',';
+		if (seed % 17 == 0)
+			word += "\xc3\xa9";	// e-acute
+		word += (seed % 13 == 0) ? '\n' : ' ';
+		out << word;
+		written += word.size();
+	}
+}
+
+static double Seconds(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void Report(const char* name, size_t bytes, size_t tokens, double seconds)
+{
+	printf("%-14s %10.1f MB/s  %12.0f tokens/s  (%zu tokens)\n", name, 
+		bytes / seconds / 1e6, tokens / seconds, tokens);
+}
+
+int main(int argc, char* argv[])
+{
+	string path;
+	char temp[] = "/tmp/charclass_benchXXXXXX";
+	if (argc > 1)
+	{
+		path = argv[1];
+	}
+	else
+	{
+		int fd = mkstemp(temp);
+		if (fd < 0)
+		{
+			perror("mkstemp");
+			return 1;
+		}
+		close(fd);
+		path = temp;
+		Generate(temp, 64 << 20);
+	}
+
+	size_t bytes;
+	{
+		ifstream in(path.c_str(), ios::binary | ios::ate);
+		bytes = in.tellg();
+	}
+
+	// the old istream path
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		ifstream in(path.c_str());
+		string token;
+		size_t tokens = 0, letters = 0;
+		while (in >> token)
+		{
+			OldToLower(token);
+			OldRemovePunct(token);
+			letters += token.size();
+			tokens++;
+		}
+		Report("istream", bytes, tokens, Seconds(start));
+	}
+
+	const char* kernels[] = { "scalar", "sse2", "avx2" };
+	for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+	{
+		if (!SelectCharKernels(kernels[k]))
+			continue;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		Tokenizer in;
+		in.Open(path.c_str());
+		TokenNormalizer normalizer(PUNCT_LEGACY, false);
+		string buffer;
+		string_view token;
+		bool lower;
+		size_t tokens = 0, letters = 0;
+		while (in.Next(token, lower))
+		{
+			string_view word = lower ? token : normalizer.Normalize(token, buffer);
+			letters += word.size();
+			tokens++;
+		}
+		Report(kernels[k], bytes, tokens, Seconds(start));
+	}
+
+	// UTF-8 normalization, with whichever kernels were selected last
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		Tokenizer in;
+		in.Open(path.c_str());
+		TokenNormalizer normalizer(PUNCT_DROP, false);
+		string buffer;
+		string_view token;
+		bool lower;
+		size_t tokens = 0, letters = 0;
+		while (in.Next(token, lower))
+		{
+			string_view word = lower ? token : normalizer.Normalize(token, buffer);
+			letters += word.size();
+			tokens++;
+		}
+		Report("utf8", bytes, tokens, Seconds(start));
+	}
+
+	if (argc <= 1)
+		unlink(temp);
+	return 0;
+}
@@ -0,0 +1,482 @@
+///////////////////////////////////////////////////////////////////////////////
+// pipeline_bench.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark for each stage of spasmifytext's pipeline, run on a synthetic
+// corpus so that the numbers can be compared from one build to the next.
+//
+// The corpus is generated from a seed: documents of words drawn from a Zipf
+// distribution over a made up vocabulary, whose most frequent words are
+// common English stop words and many of the rest have English suffixes for
+// the stemmer to take off.  Some words are capitalized or have punctuation
+// stuck to them.  The same options always give the same corpus.
+//
+// Each stage is timed on its own, over the whole corpus, with the output of
+// the stage before it held in memory:
+//     tokenize    the Tokenizer, over every file
+//     normalize   splitting at punctuation and lower casing (what used to be
+//                 ToLower() and RemovePunct())
+//     stem        the Porter stemmer
+//     stopwords   removing the default stop words
+//     count       interning into a TermDictionary and counting into a
+//                 DocumentTable
+//     write       numbering the dimensions and writing a single file
+// The results, with throughput in MB/s and tokens/s of each stage's input and
+// the peak resident set size so far, are printed as JSON.
+//
+// Build from the top of the tree with
+//     g++ -O2 -std=c++17 -Wall -pthread -I. -o pipeline_bench
+//         bench/pipeline_bench.cpp tokenizer.cpp charclass.cpp normalize.cpp
+//         unicode.cpp porter.cpp stopwords.cpp termdict.cpp arena.cpp
+//         writer.cpp
+// and run it as "pipeline_bench [OPTION]...", with the options
+//     --docs=N          documents (default 2000)
+//     --tokens=N        average words per document (default 1000)
+//     --vocabulary=N    distinct words (default 50000)
+//     --zipf=S          the Zipf exponent (default 1.0)
+//     --seed=N          (default 1)
+//     --corpus=DIR      write the corpus to DIR and keep it, so spasmifytext
+//                       can be run on the same files; otherwise it goes in a
+//                       temporary directory that is removed afterwards
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "tokenizer.h"
+#include "normalize.h"
+#include "porter.h"
+#include "stopwords.h"
+#include "termdict.h"
+#include "writer.h"
+using namespace std;
+
+// The most frequent words of the vocabulary, in order.
+static const char* const COMMON_WORDS[] = {
+	"the", "of", "and", "to", "a", "in", "is", "that", "for", "it", "as",
+	"was", "with", "be", "by", "on", "not", "he", "this", "are", "or", "his",
+	"from", "at", "which", "but", "have", "an", "had", "they"
+};
+
+static const char* const SUFFIXES[] = {
+	"ing", "ed", "s", "es", "ation", "ness", "ly", "ment", "ful", "ize",
+	"ational", "iveness", "ement", "ibility"
+};
+
+// splitmix64, which is all the randomness a benchmark needs.
+class Random
+{
+public:
+	Random(uint64_t seed) : m_state(seed) {};
+
+	uint64_t Next()
+	{
+		uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// Uniform in [0, 1).
+	double Uniform() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+	uint64_t m_state;
+};
+
+class Options
+{
+public:
+	size_t docs;
+	size_t tokens;
+	size_t vocabulary;
+	double zipf;
+	uint64_t seed;
+	string corpus;
+
+	Options() : docs(2000), tokens(1000), vocabulary(50000), zipf(1.0),
+		seed(1) {};
+};
+
+// Words held one after another in one buffer, and where each document's
+// words end.
+class WordList
+{
+public:
+	void Add(string_view word)
+	{
+		m_text.insert(m_text.end(), word.begin(), word.end());
+		m_ends.push_back(m_text.size());
+	}
+	void EndDocument() { m_documents.push_back(m_ends.size()); }
+
+	size_t Size() const { return m_ends.size(); }
+	size_t Bytes() const { return m_text.size(); }
+	size_t Documents() const { return m_documents.size(); }
+	string_view Word(size_t i) const
+	{
+		size_t start = i == 0 ? 0 : m_ends[i - 1];
+		return string_view(m_text.data() + start, m_ends[i] - start);
+	}
+	// words [DocumentBegin(d), DocumentEnd(d)) are in document d
+	size_t DocumentBegin(size_t d) const { return d == 0 ? 0 : m_documents[d - 1]; }
+	size_t DocumentEnd(size_t d) const { return m_documents[d]; }
+
+private:
+	vector<char> m_text;
+	vector<size_t> m_ends;
+	vector<size_t> m_documents;
+};
+
+// Makes up the vocabulary, most frequent word first.
+static void MakeVocabulary(const Options& options, vector<string>& words)
+{
+	Random random(options.seed * 31 + 7);
+	unordered_set<string> seen;
+	for (size_t i = 0; i < options.vocabulary; i++)
+	{
+		string word;
+		if (i < sizeof(COMMON_WORDS) / sizeof(COMMON_WORDS[0]))
+			word = COMMON_WORDS[i];
+		while (word.empty() || seen.count(word) > 0)
+		{
+			word.clear();
+			size_t length = 2 + random.Next() % 8;
+			for (size_t k = 0; k < length; k++)
+				word += (char) ('a' + random.Next() % 26);
+			if (random.Next() % 3 == 0)
+				word += SUFFIXES[random.Next() %
+					(sizeof(SUFFIXES) / sizeof(SUFFIXES[0]))];
+		}
+		seen.insert(word);
+		words.push_back(word);
+	}
+}
+
+// Writes the corpus into directory, and returns how big it is.
+static size_t Generate(const Options& options, const string& directory,
+					   vector<string>& filenames)
+{
+	vector<string> vocabulary;
+	MakeVocabulary(options, vocabulary);
+
+	// the cumulative Zipf distribution, to binary search
+	vector<double> cumulative(vocabulary.size());
+	double total = 0;
+	for (size_t rank = 0; rank < vocabulary.size(); rank++)
+	{
+		total += 1 / pow((double) (rank + 1), options.zipf);
+		cumulative[rank] = total;
+	}
+
+	Random random(options.seed);
+	size_t bytes = 0;
+	string text;
+	for (size_t doc = 0; doc < options.docs; doc++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "/doc%06zu.txt", doc + 1);
+		filenames.push_back(directory + name);
+
+		// lengths vary from half to one and a half times the average
+		size_t length = options.tokens / 2 +
+			random.Next() % (options.tokens + 1);
+		text.clear();
+		for (size_t t = 0; t < length; t++)
+		{
+			double u = random.Uniform() * total;
+			size_t rank = lower_bound(cumulative.begin(), cumulative.end(), u) -
+				cumulative.begin();
+			if (rank >= vocabulary.size())
+				rank = vocabulary.size() - 1;
+
+			size_t start = text.size();
+			text += vocabulary[rank];
+			uint64_t r = random.Next();
+			if (r % 7 == 0)
+				text[start] = (char) (text[start] - 'a' + 'A');
+			if (r % 11 == 0)
+				text += (r % 2 == 0) ? ',' : '.';
+			text += (r % 13 == 0) ? '\n' : ' ';
+		}
+
+		FILE* out = fopen(filenames.back().c_str(), "wb");
+		if (out == NULL || fwrite(text.data(), 1, text.size(), out) !=
+			text.size() || fclose(out) != 0)
+		{
+			perror(filenames.back().c_str());
+			exit(1);
+		}
+		bytes += text.size();
+	}
+	return bytes;
+}
+
+static double Seconds(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static long PeakRssKb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+// Prints one stage's results as a JSON object.
+static void Report(const char* stage, size_t bytes, size_t tokens,
+				   double seconds, bool last)
+{
+	printf("    {\"stage\": \"%s\", \"seconds\": %.6f, \"bytes\": %zu, "
+		"\"tokens\": %zu, \"mb_per_s\": %.2f, \"tokens_per_s\": %.0f, "
+		"\"peak_rss_kb\": %ld}%s\n", stage, seconds, bytes, tokens,
+		bytes / seconds / 1e6, tokens / seconds, PeakRssKb(), last ? "" : ",");
+}
+
+static bool ParseOption(const char* arg, Options& options)
+{
+	const char* value = strchr(arg, '=');
+	if (value == NULL)
+		return false;
+	value++;
+	char* end;
+	if (strncmp(arg, "--docs=", 7) == 0)
+		options.docs = strtoul(value, &end, 10);
+	else if (strncmp(arg, "--tokens=", 9) == 0)
+		options.tokens = strtoul(value, &end, 10);
+	else if (strncmp(arg, "--vocabulary=", 13) == 0)
+		options.vocabulary = strtoul(value, &end, 10);
+	else if (strncmp(arg, "--zipf=", 7) == 0)
+		options.zipf = strtod(value, &end);
+	else if (strncmp(arg, "--seed=", 7) == 0)
+		options.seed = strtoull(value, &end, 10);
+	else if (strncmp(arg, "--corpus=", 9) == 0)
+	{
+		options.corpus = value;
+		return options.corpus != "";
+	}
+	else
+		return false;
+	return *value != '\0' && *end == '\0';
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!ParseOption(argv[i], options))
+		{
+			fprintf(stderr, "usage: pipeline_bench [--docs=N] [--tokens=N] "
+				"[--vocabulary=N] [--zipf=S] [--seed=N] [--corpus=DIR]\n");
+			return 1;
+		}
+	}
+	if (options.vocabulary < sizeof(COMMON_WORDS) / sizeof(COMMON_WORDS[0]))
+		options.vocabulary = sizeof(COMMON_WORDS) / sizeof(COMMON_WORDS[0]);
+
+	string directory = options.corpus;
+	char temp[] = "/tmp/pipeline_benchXXXXXX";
+	if (directory == "")
+	{
+		if (mkdtemp(temp) == NULL)
+		{
+			perror("mkdtemp");
+			return 1;
+		}
+		directory = temp;
+	}
+	else
+	{
+		mkdir(directory.c_str(), 0777);
+	}
+
+	vector<string> filenames;
+	size_t corpusBytes = Generate(options, directory, filenames);
+
+	printf("{\n  \"corpus\": {\"documents\": %zu, \"tokens_per_document\": %zu, "
+		"\"vocabulary\": %zu, \"zipf\": %g, \"seed\": %llu, \"bytes\": %zu},\n"
+		"  \"stages\": [\n", options.docs, options.tokens, options.vocabulary,
+		options.zipf, (unsigned long long) options.seed, corpusBytes);
+
+	// tokenize
+	WordList tokens;
+	vector<bool> lowerTokens;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	{
+		Tokenizer in;
+		string_view token;
+		bool lower;
+		for (size_t doc = 0; doc < filenames.size(); doc++)
+		{
+			in.Open(filenames[doc].c_str());
+			while (in.Next(token, lower))
+			{
+				tokens.Add(token);
+				lowerTokens.push_back(lower);
+			}
+			in.Close();
+			tokens.EndDocument();
+		}
+	}
+	Report("tokenize", corpusBytes, tokens.Size(), Seconds(start), false);
+
+	// normalize
+	WordList normalized;
+	start = chrono::steady_clock::now();
+	{
+		TokenNormalizer normalizer(PUNCT_DROP, false);
+		vector<string_view> pieces;
+		string buffer;
+		for (size_t doc = 0; doc < tokens.Documents(); doc++)
+		{
+			for (size_t i = tokens.DocumentBegin(doc);
+				i < tokens.DocumentEnd(doc); i++)
+			{
+				if (lowerTokens[i])
+				{
+					normalized.Add(tokens.Word(i));
+					continue;
+				}
+				normalizer.Split(tokens.Word(i), pieces);
+				for (size_t p = 0; p < pieces.size(); p++)
+				{
+					string_view word = normalizer.Normalize(pieces[p], buffer);
+					if (word.size() > 0)
+						normalized.Add(word);
+				}
+			}
+			normalized.EndDocument();
+		}
+	}
+	Report("normalize", tokens.Bytes(), tokens.Size(), Seconds(start), false);
+
+	// stem
+	WordList stemmed;
+	start = chrono::steady_clock::now();
+	{
+		string buffer;
+		for (size_t doc = 0; doc < normalized.Documents(); doc++)
+		{
+			for (size_t i = normalized.DocumentBegin(doc);
+				i < normalized.DocumentEnd(doc); i++)
+			{
+				string_view word = normalized.Word(i);
+				buffer.assign(word.data(), word.size());
+				int end = stem(&buffer[0], 0, (int) buffer.size() - 1);
+				stemmed.Add(string_view(buffer.data(), end + 1));
+			}
+			stemmed.EndDocument();
+		}
+	}
+	Report("stem", normalized.Bytes(), normalized.Size(), Seconds(start), false);
+
+	// stop words
+	WordList kept;
+	start = chrono::steady_clock::now();
+	{
+		StopList stopList;
+		for (size_t doc = 0; doc < stemmed.Documents(); doc++)
+		{
+			for (size_t i = stemmed.DocumentBegin(doc);
+				i < stemmed.DocumentEnd(doc); i++)
+			{
+				if (!stopList.Contains(stemmed.Word(i)))
+					kept.Add(stemmed.Word(i));
+			}
+			kept.EndDocument();
+		}
+	}
+	Report("stopwords", stemmed.Bytes(), stemmed.Size(), Seconds(start), false);
+
+	// count
+	TermDictionary dictionary;
+	DocumentTable documents;
+	start = chrono::steady_clock::now();
+	for (size_t doc = 0; doc < kept.Documents(); doc++)
+	{
+		documents.BeginDocument(filenames[doc]);
+		for (size_t i = kept.DocumentBegin(doc); i < kept.DocumentEnd(doc); i++)
+		{
+			string_view word = kept.Word(i);
+			documents.AddTerm(dictionary.Intern(word.data(), word.size()));
+		}
+		documents.EndDocument();
+	}
+	Report("count", kept.Bytes(), kept.Size(), Seconds(start), false);
+
+	// write, the way a single file is written
+	string output = directory + "/bench.edsf";
+	size_t written = 0;
+	start = chrono::steady_clock::now();
+	{
+		vector<unsigned int> order;
+		dictionary.SortedOrder(order);
+		vector<unsigned int> dimensionOf(order.size());
+		for (unsigned int dimension = 0; dimension < order.size(); dimension++)
+			dimensionOf[order[dimension]] = dimension;
+		documents.Renumber(dimensionOf);
+
+		OutputFile out;
+		if (!out.Open(output))
+		{
+			perror(output.c_str());
+			return 1;
+		}
+		out.Write("bench.edsf\n^^^^^^^^\nText data\n^^^^^^^^\n");
+		for (unsigned int dimension = 0; dimension < order.size(); dimension++)
+		{
+			out.Write('\t');
+			out.WriteNumber(dimension);
+			out.Write('\t');
+			out.Write(dictionary.Term(order[dimension]));
+			out.Write('\n');
+		}
+		for (unsigned int doc = 0; doc < documents.Size(); doc++)
+		{
+			out.Write("^^^^^^^^\n");
+			out.Write(documents.Name(doc));
+			out.Write("\n^^^^^^^^\n");
+			for (const TermCount* entry = documents.Begin(doc);
+				entry != documents.End(doc); entry++)
+			{
+				out.WriteNumber(entry->term);
+				out.Write('\t');
+				out.WriteNumber(entry->count);
+				out.Write('\n');
+			}
+		}
+		if (!out.Close())
+		{
+			perror(output.c_str());
+			return 1;
+		}
+		struct stat info;
+		if (stat(output.c_str(), &info) == 0)
+			written = info.st_size;
+	}
+	Report("write", written, kept.Size(), Seconds(start), true);
+
+	printf("  ],\n  \"words\": %zu,\n  \"peak_rss_kb\": %ld\n}\n",
+		dictionary.Size(), PeakRssKb());
+
+	// leave a corpus that was asked for, but not the output
+	unlink(output.c_str());
+	if (options.corpus == "")
+	{
+		for (size_t doc = 0; doc < filenames.size(); doc++)
+			unlink(filenames[doc].c_str());
+		rmdir(directory.c_str());
+	}
+	return 0;
+}
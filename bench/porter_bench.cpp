@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+// porter_bench.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Checks the table-driven suffix phase of stem() against stem_reference(),
+// the original cascades of suffix tests, and times the two.
+//
+// Every word is stemmed both ways and the results have to be byte for byte
+// the same; any that aren't are printed and the exit status is 1.  The
+// words are, besides those of any files given:
+//     every string of up to 5 letters from "aeiouylstnbcz", so that every
+//     pattern of consonants, vowels and y's that short comes up
+//     made up stems with each suffix stem() knows, and the ones step 1 takes
+//     off, after them
+//     a few words longer than stem()'s 64 letter mask, which take the
+//     cascades
+// Words with UTF-8 characters in them also have to stem to what UTF8_STEMS
+// says, with every character left whole.
+//
+// Build from the top of the tree with
+//     g++ -O2 -std=c++17 -Wall -I. -o porter_bench bench/porter_bench.cpp
+//         porter.cpp
+// and run it as "porter_bench [FILE]...".  The words of a file are its runs
+// of letters, lower cased.
+///////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <ctype.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "porter.h"
+using namespace std;
+
+static const char* const SUFFIXES[] = { "", "e", "ll", "y", "at", "bl",
+	"iz", "ational", "tional", "enci", "anci", "izer", "bli", "abli", "alli",
+	"entli", "eli", "ousli", "ization", "ation", "ator", "alism", "iveness",
+	"fulness", "ousness", "aliti", "iviti", "biliti", "logi", "icate",
+	"ative", "alize", "iciti", "ical", "ful", "ness", "al", "ance", "ence",
+	"er", "ic", "able", "ible", "ant", "ement", "ment", "ent", "sion", "tion",
+	"ion", "ou", "ism", "ate", "iti", "ous", "ive", "ize" };
+
+static const char* const ENDINGS[] = { "", "s", "es", "ies", "sses", "ed",
+	"eed", "ing", "ly", "y" };
+
+// Words with UTF-8 characters in them and what they stem to.  The last two
+// bytes of E4 BA BA mustn't be taken for a double consonant.
+static const char* const UTF8_STEMS[][2] = {
+	{ "ka\xe4\xba\xba" "ed", "ka\xe4\xba\xba" },
+	{ "ka\xe4\xba\xba" "ing", "ka\xe4\xba\xba" },
+	{ "\xe4\xba\xba\xe4\xba\xba" "ed", "\xe4\xba\xba\xe4\xba\xba" "ed" },
+	{ "caf\xc3\xa9s", "caf\xc3\xa9" },
+	{ "ma\xc3\x9f\xc3\x9f" "ed", "ma\xc3\x9f\xc3\x9f" }
+};
+
+static void AllStrings(const string& letters, string& word, size_t length,
+	vector<string>& words)
+{
+	if (word.size() > 0)
+		words.push_back(word);
+	if (word.size() == length)
+		return;
+	for (size_t i = 0; i < letters.size(); i++)
+	{
+		word += letters[i];
+		AllStrings(letters, word, length, words);
+		word.pop_back();
+	}
+}
+
+static void Generate(vector<string>& words)
+{
+	string word;
+	AllStrings("aeiouylstnbcz", word, 5, words);
+
+	unsigned int seed = 12345;
+	const char* letters = "bcdfghjklmnprstvwxyzaeiouaeiouy";
+	for (int stems = 0; stems < 3000; stems++)
+	{
+		string root;
+		seed = seed * 1103515245 + 12345;
+		int length = 1 + (seed >> 16) % 8;
+		for (int i = 0; i < length; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			root += letters[(seed >> 16) % 31];
+		}
+		for (const char* suffix : SUFFIXES)
+		{
+			for (const char* ending : ENDINGS)
+				words.push_back(root + suffix + ending);
+		}
+	}
+
+	for (int length = 60; length < 70; length++)
+	{
+		for (const char* suffix : SUFFIXES)
+		{
+			string root;
+			for (int i = 0; (int) root.size() < length; i++)
+				root += "yabcelo"[i % 7];
+			words.push_back(root + suffix);
+		}
+	}
+}
+
+static void ReadWords(const char* path, vector<string>& words)
+{
+	ifstream in(path);
+	if (!in)
+	{
+		cerr << "porter_bench: can't read " << path << endl;
+		return;
+	}
+	string word;
+	char ch;
+	while (in.get(ch))
+	{
+		if (isalpha((unsigned char) ch))
+			word += (char) tolower((unsigned char) ch);
+		else if (word.size() > 0)
+		{
+			words.push_back(word);
+			word.clear();
+		}
+	}
+	if (word.size() > 0)
+		words.push_back(word);
+}
+
+// The best of a few passes, in seconds.
+static double Time(int (*stemmer)(char*, int, int),
+	const vector<string>& words, size_t& letters)
+{
+	string buffer;
+	double best = 0;
+	for (int pass = 0; pass < 5; pass++)
+	{
+		letters = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (size_t i = 0; i < words.size(); i++)
+		{
+			buffer = words[i];
+			letters += stemmer(&buffer[0], 0, (int) buffer.size() - 1) + 1;
+		}
+		double seconds = chrono::duration<double>(
+			chrono::steady_clock::now() - start).count();
+		if (pass == 0 || seconds < best)
+			best = seconds;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	vector<string> words;
+	Generate(words);
+	for (int i = 1; i < argc; i++)
+		ReadWords(argv[i], words);
+
+	size_t mismatches = 0;
+	string fast, reference;
+	for (size_t i = 0; i < words.size(); i++)
+	{
+		fast = reference = words[i];
+		fast.resize(stem(&fast[0], 0, (int) fast.size() - 1) + 1);
+		reference.resize(
+			stem_reference(&reference[0], 0, (int) reference.size() - 1) + 1);
+		if (fast != reference)
+		{
+			if (mismatches++ < 20)
+			{
+				printf("%s: stem() gives %s, stem_reference() %s\n",
+					words[i].c_str(), fast.c_str(), reference.c_str());
+			}
+		}
+	}
+	for (const auto& expected : UTF8_STEMS)
+	{
+		fast = reference = expected[0];
+		fast.resize(stem(&fast[0], 0, (int) fast.size() - 1) + 1);
+		reference.resize(
+			stem_reference(&reference[0], 0, (int) reference.size() - 1) + 1);
+		if (fast != expected[1] || reference != expected[1])
+		{
+			mismatches++;
+			printf("%s: stem() gives %s, stem_reference() %s, not %s\n",
+				expected[0], fast.c_str(), reference.c_str(), expected[1]);
+		}
+	}
+	printf("%zu words, %zu different\n", words.size(), mismatches);
+
+	size_t letters, check;
+	double reference_seconds = Time(stem_reference, words, check);
+	double seconds = Time(stem, words, letters);
+	printf("stem_reference() %10.0f words/s\n", words.size() /
+		reference_seconds);
+	printf("stem()           %10.0f words/s\n", words.size() / seconds);
+	return mismatches == 0 && letters == check ? 0 : 1;
+}
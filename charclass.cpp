@@ -0,0 +1,215 @@
+///////////////////////////////////////////////////////////////////////////////
+// charclass.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Scalar, SSE2 and AVX2 versions of the character kernels, and picking
+// between them at run time.  See charclass.h.
+//
+// The vector versions classify bytes with unsigned range checks: c is in
+// [lo, lo+n] exactly when min(c-lo, n) == c-lo, with the subtraction
+// wrapping.  Whitespace is ' ' or [\t, \r], and a lower case letter is
+// [a, z].  Letters of either case are the bytes whose (c | 0x20) is a lower
+// case letter, and that same OR lower cases them.
+///////////////////////////////////////////////////////////////////////////////
+#include "charclass.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHARCLASS_X86
+#include <immintrin.h>
+#endif
+
+static void ScalarClassifyBlock(const char* p, uint64_t& spaces,
+								uint64_t& other)
+{
+	spaces = 0;
+	other = 0;
+	for (int i = 0; i < 64; i++)
+	{
+		unsigned char c = p[i];
+		if (IsSpace(c))
+			spaces |= (uint64_t) 1 << i;
+		else if (!IsLower(c))
+			other |= (uint64_t) 1 << i;
+	}
+}
+
+static size_t ScalarLowerLetters(const char* in, size_t length, char* out)
+{
+	size_t i = 0;
+	while (i < length && IsAlpha(in[i]))
+	{
+		out[i] = in[i] | 0x20;
+		i++;
+	}
+	return i;
+}
+
+#ifdef CHARCLASS_X86
+
+__attribute__((target("sse2")))
+static void Sse2ClassifyBlock(const char* p, uint64_t& spaces, uint64_t& other)
+{
+	const __m128i blank = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i controls = _mm_set1_epi8('\r' - '\t');
+	const __m128i a = _mm_set1_epi8('a');
+	const __m128i letters = _mm_set1_epi8('z' - 'a');
+
+	spaces = 0;
+	other = 0;
+	for (int i = 0; i < 64; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*) (p + i));
+		__m128i c = _mm_sub_epi8(x, tab);
+		__m128i space = _mm_or_si128(_mm_cmpeq_epi8(x, blank),
+			_mm_cmpeq_epi8(_mm_min_epu8(c, controls), c));
+		__m128i l = _mm_sub_epi8(x, a);
+		__m128i lower = _mm_cmpeq_epi8(_mm_min_epu8(l, letters), l);
+
+		uint64_t s = (unsigned int) _mm_movemask_epi8(space);
+		uint64_t k = (unsigned int) _mm_movemask_epi8(_mm_or_si128(space, lower));
+		spaces |= s << i;
+		other |= (~k & 0xffff) << i;
+	}
+}
+
+__attribute__((target("sse2")))
+static size_t Sse2LowerLetters(const char* in, size_t length, char* out)
+{
+	const __m128i caseBit = _mm_set1_epi8(0x20);
+	const __m128i a = _mm_set1_epi8('a');
+	const __m128i letters = _mm_set1_epi8('z' - 'a');
+
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i x = _mm_or_si128(_mm_loadu_si128((const __m128i*) (in + i)),
+			caseBit);
+		__m128i l = _mm_sub_epi8(x, a);
+		unsigned int alpha = _mm_movemask_epi8(
+			_mm_cmpeq_epi8(_mm_min_epu8(l, letters), l));
+		_mm_storeu_si128((__m128i*) (out + i), x);
+		if (alpha != 0xffff)
+			return i + __builtin_ctz(~alpha);
+	}
+	return i + ScalarLowerLetters(in + i, length - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static void Avx2ClassifyBlock(const char* p, uint64_t& spaces, uint64_t& other)
+{
+	const __m256i blank = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i controls = _mm256_set1_epi8('\r' - '\t');
+	const __m256i a = _mm256_set1_epi8('a');
+	const __m256i letters = _mm256_set1_epi8('z' - 'a');
+
+	spaces = 0;
+	other = 0;
+	for (int i = 0; i < 64; i += 32)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*) (p + i));
+		__m256i c = _mm256_sub_epi8(x, tab);
+		__m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(x, blank),
+			_mm256_cmpeq_epi8(_mm256_min_epu8(c, controls), c));
+		__m256i l = _mm256_sub_epi8(x, a);
+		__m256i lower = _mm256_cmpeq_epi8(_mm256_min_epu8(l, letters), l);
+
+		uint64_t s = (unsigned int) _mm256_movemask_epi8(space);
+		uint64_t k = (unsigned int) _mm256_movemask_epi8(
+			_mm256_or_si256(space, lower));
+		spaces |= s << i;
+		other |= (~k & 0xffffffffu) << i;
+	}
+}
+
+__attribute__((target("avx2")))
+static size_t Avx2LowerLetters(const char* in, size_t length, char* out)
+{
+	const __m256i caseBit = _mm256_set1_epi8(0x20);
+	const __m256i a = _mm256_set1_epi8('a');
+	const __m256i letters = _mm256_set1_epi8('z' - 'a');
+
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32)
+	{
+		__m256i x = _mm256_or_si256(
+			_mm256_loadu_si256((const __m256i*) (in + i)), caseBit);
+		__m256i l = _mm256_sub_epi8(x, a);
+		unsigned int alpha = _mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(_mm256_min_epu8(l, letters), l));
+		_mm256_storeu_si256((__m256i*) (out + i), x);
+		if (alpha != 0xffffffffu)
+			return i + __builtin_ctz(~alpha);
+	}
+
+	// Finish off with a 16 byte step here rather than calling the SSE2
+	// kernel, which would pay for switching from AVX to legacy SSE code.
+	if (i + 16 <= length)
+	{
+		__m128i x = _mm_or_si128(_mm_loadu_si128((const __m128i*) (in + i)),
+			_mm256_castsi256_si128(caseBit));
+		__m128i l = _mm_sub_epi8(x, _mm256_castsi256_si128(a));
+		unsigned int alpha = _mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_min_epu8(l, _mm256_castsi256_si128(letters)), l));
+		_mm_storeu_si128((__m128i*) (out + i), x);
+		if (alpha != 0xffff)
+			return i + __builtin_ctz(~alpha);
+		i += 16;
+	}
+	return i + ScalarLowerLetters(in + i, length - i, out + i);
+}
+
+#endif
+
+static const CharKernels g_scalar =
+	{ "scalar", ScalarClassifyBlock, ScalarLowerLetters };
+#ifdef CHARCLASS_X86
+static const CharKernels g_sse2 =
+	{ "sse2", Sse2ClassifyBlock, Sse2LowerLetters };
+static const CharKernels g_avx2 =
+	{ "avx2", Avx2ClassifyBlock, Avx2LowerLetters };
+#endif
+
+static const CharKernels* BestCharKernels()
+{
+#ifdef CHARCLASS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return &g_avx2;
+	if (__builtin_cpu_supports("sse2"))
+		return &g_sse2;
+#endif
+	return &g_scalar;
+}
+
+static const CharKernels* g_kernels = BestCharKernels();
+
+const CharKernels& GetCharKernels()
+{
+	return *g_kernels;
+}
+
+bool SelectCharKernels(const char* name)
+{
+	if (strcmp(name, "scalar") == 0)
+	{
+		g_kernels = &g_scalar;
+		return true;
+	}
+#ifdef CHARCLASS_X86
+	__builtin_cpu_init();
+	if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2"))
+	{
+		g_kernels = &g_sse2;
+		return true;
+	}
+	if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+	{
+		g_kernels = &g_avx2;
+		return true;
+	}
+#endif
+	return false;
+}
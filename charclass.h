@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// charclass.h
+///////////////////////////////////////////////////////////////////////////////
+// Vectorized character classification and lower casing for the tokenizer.
+//
+// ClassifyBlock() looks at 64 bytes at a time and returns bit masks saying
+// which of them are whitespace and which are neither whitespace nor a lower
+// case letter, so the tokenizer can find token boundaries (and whether a
+// token needs normalizing at all) with a few bit operations per token instead
+// of a test per byte.  LowerLetters() lower cases the leading run of letters
+// of a token 16 or 32 bytes at a time.
+//
+// There are scalar, SSE2 and AVX2 versions of each kernel.  The best one the
+// CPU supports is picked once, as the program starts (during static
+// initialization, so before main()); SelectCharKernels() can force a
+// particular one, for benchmarking.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CHARCLASS_H
+#define CHARCLASS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The characters isspace() accepts in the "C" locale.
+inline bool IsSpace(unsigned char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool IsLower(unsigned char c)
+{
+	return c >= 'a' && c <= 'z';
+}
+
+inline bool IsAlpha(unsigned char c)
+{
+	return IsLower(c | 0x20);
+}
+
+inline char ToLower(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+}
+
+class CharKernels
+{
+public:
+	const char* name;
+
+	// Classifies p[0..64).  Bit i of spaces is set if p[i] is whitespace, and
+	// bit i of other is set if p[i] is neither whitespace nor a lower case
+	// letter.
+	void (*ClassifyBlock)(const char* p, uint64_t& spaces, uint64_t& other);
+
+	// Copies the letters at the start of in[0..length) to out, lower casing
+	// them, and returns how many there were.  Stops at the first byte that
+	// isn't a letter.  out must have room for length bytes.
+	size_t (*LowerLetters)(const char* in, size_t length, char* out);
+};
+
+// The kernels in use.
+const CharKernels& GetCharKernels();
+
+// Forces the kernels named "scalar", "sse2" or "avx2" to be used.  Returns
+// false, changing nothing, if they don't exist or the CPU can't run them.
+bool SelectCharKernels(const char* name);
+
+#endif
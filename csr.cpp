@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// csr.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Writing and mapping .csr files.  See csr.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "csr.h"
+#include "termdict.h"
+#include "writer.h"
+#include "spill.h"
+#include "weight.h"
+#include "hashdims.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+static_assert(sizeof(CsrHeader) == 120, "CsrHeader must have no padding");
+
+static const char CSR_MAGIC[8] = { 'S', 'P', 'A', 'S', 'M', 'C', 'S', 'R' };
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CSR_BIG_ENDIAN
+#endif
+
+static void WriteLittleEndian(OutputFile& out, uint64_t value, int bytes)
+{
+	char data[8];
+	for (int i = 0; i < bytes; i++)
+		data[i] = (char) (value >> (8 * i));
+	out.Write(data, bytes);
+}
+
+static void WriteLittleEndian(OutputFile& out, const uint64_t* values,
+							  size_t count)
+{
+#ifdef CSR_BIG_ENDIAN
+	for (size_t i = 0; i < count; i++)
+		WriteLittleEndian(out, values[i], 8);
+#else
+	out.Write((const char*) values, count * sizeof(uint64_t));
+#endif
+}
+
+static uint64_t Align(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t) 7;
+}
+
+static void Pad(OutputFile& out, uint64_t length)
+{
+	static const char zeros[8] = { 0 };
+	out.Write(zeros, Align(length) - length);
+}
+
+bool WriteCsr(const string& filename, const string& title,
+			  const TermDictionary* dictionary, const vector<unsigned int>& order,
+			  const FeatureHasher* hasher, DocumentReader& rows,
+			  const Weigher* weigher)
+{
+	const DocumentTable& documents = rows.Documents();
+	CsrHeader header;
+	memcpy(header.magic, CSR_MAGIC, sizeof(header.magic));
+	header.version = CSR_VERSION;
+	header.flags = (weigher != NULL ? CSR_WEIGHTS : 0) |
+		(dictionary == NULL ? CSR_HASHED : 0);
+	header.rows = documents.Size();
+	header.columns = dictionary != NULL ? order.size() : hasher->Dimensions();
+
+	// hashed dimensions have no words, just the seed in place of the offsets
+	vector<uint64_t> termOffsets(1, dictionary != NULL ? 0 : hasher->Seed());
+	for (size_t d = 0; dictionary != NULL && d < order.size(); d++)
+	{
+		termOffsets.push_back(termOffsets.back() +
+			dictionary->Term(order[d]).size());
+	}
+	uint64_t termBytes = dictionary != NULL ? termOffsets.back() : 0;
+
+	// a first pass over the rows to find out how long each one is
+	vector<uint64_t> nameOffsets(1, 0);
+	vector<uint64_t> rowPointers(1, 0);
+	const TermCount* begin;
+	const TermCount* end;
+	bool read = rows.Rewind();
+	for (unsigned int doc = 0; read && doc < documents.Size(); doc++)
+	{
+		read = rows.Next(begin, end);
+		nameOffsets.push_back(nameOffsets.back() + documents.Name(doc).size());
+		rowPointers.push_back(rowPointers.back() + (end - begin));
+	}
+	if (!read)
+		return false;
+	header.nonZeros = rowPointers.back();
+
+	// lay out the sections one after another
+	header.titleOffset = sizeof(CsrHeader);
+	header.titleLength = title.size();
+	header.termOffsets = Align(header.titleOffset + header.titleLength);
+	header.termText = header.termOffsets + termOffsets.size() * sizeof(uint64_t);
+	header.nameOffsets = Align(header.termText + termBytes);
+	header.nameText = header.nameOffsets + nameOffsets.size() * sizeof(uint64_t);
+	header.rowPointers = Align(header.nameText + nameOffsets.back());
+	header.columnIndices = header.rowPointers +
+		rowPointers.size() * sizeof(uint64_t);
+	header.counts = Align(header.columnIndices +
+		header.nonZeros * sizeof(uint32_t));
+	header.fileSize = Align(header.counts + header.nonZeros * sizeof(uint32_t));
+
+	OutputFile out;
+	if (!out.Open(filename))
+		return false;
+
+	out.Write(header.magic, sizeof(header.magic));
+	WriteLittleEndian(out, header.version, 4);
+	WriteLittleEndian(out, header.flags, 4);
+	const uint64_t fields[] = { header.rows, header.columns, header.nonZeros,
+		header.titleOffset, header.titleLength, header.termOffsets,
+		header.termText, header.nameOffsets, header.nameText,
+		header.rowPointers, header.columnIndices, header.counts,
+		header.fileSize };
+	WriteLittleEndian(out, fields, sizeof(fields) / sizeof(fields[0]));
+
+	out.Write(title);
+	Pad(out, header.titleLength);
+
+	WriteLittleEndian(out, termOffsets.data(), termOffsets.size());
+	for (size_t d = 0; dictionary != NULL && d < order.size(); d++)
+		out.Write(dictionary->Term(order[d]));
+	Pad(out, termBytes);
+
+	WriteLittleEndian(out, nameOffsets.data(), nameOffsets.size());
+	for (unsigned int doc = 0; doc < documents.Size(); doc++)
+		out.Write(documents.Name(doc));
+	Pad(out, nameOffsets.back());
+
+	// the columns and then the counts, in two more passes over the rows
+	WriteLittleEndian(out, rowPointers.data(), rowPointers.size());
+	read = rows.Rewind();
+	for (unsigned int doc = 0; read && doc < documents.Size(); doc++)
+	{
+		read = rows.Next(begin, end);
+		for (const TermCount* entry = begin; read && entry != end; entry++)
+			WriteLittleEndian(out, entry->term, 4);
+	}
+	Pad(out, header.nonZeros * sizeof(uint32_t));
+	read = read && rows.Rewind();
+	vector<float> weights;
+	for (unsigned int doc = 0; read && doc < documents.Size(); doc++)
+	{
+		read = rows.Next(begin, end);
+		if (!read)
+			break;
+		if (weigher == NULL)
+		{
+			for (const TermCount* entry = begin; entry != end; entry++)
+				WriteLittleEndian(out, entry->count, 4);
+			continue;
+		}
+
+		weigher->Weigh(begin, end, weights);
+		for (size_t i = 0; i < weights.size(); i++)
+		{
+			uint32_t bits;
+			memcpy(&bits, &weights[i], sizeof(bits));
+			WriteLittleEndian(out, bits, 4);
+		}
+	}
+	Pad(out, header.nonZeros * sizeof(uint32_t));
+
+	return out.Close() && read;
+}
+
+CsrFile::CsrFile()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_header = NULL;
+}
+
+CsrFile::~CsrFile()
+{
+	Close();
+}
+
+void CsrFile::Close()
+{
+	if (m_data != NULL)
+		munmap((void*) m_data, m_size);
+	m_data = NULL;
+	m_size = 0;
+	m_header = NULL;
+}
+
+bool CsrFile::Open(const char* filename)
+{
+	Close();
+#ifdef CSR_BIG_ENDIAN
+	// the arrays are used in place, so they have to be in the host's order
+	return false;
+#endif
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+		(size_t) info.st_size >= sizeof(CsrHeader))
+	{
+		void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED)
+		{
+			m_data = (const char*) map;
+			m_size = info.st_size;
+		}
+	}
+	close(fd);
+	if (m_data == NULL)
+		return false;
+
+	m_header = (const CsrHeader*) m_data;
+	if (!Check())
+	{
+		Close();
+		return false;
+	}
+	m_termOffsets = (const uint64_t*) (m_data + m_header->termOffsets);
+	m_nameOffsets = (const uint64_t*) (m_data + m_header->nameOffsets);
+	m_rowPointers = (const uint64_t*) (m_data + m_header->rowPointers);
+	m_columns = (const uint32_t*) (m_data + m_header->columnIndices);
+	m_counts = (const uint32_t*) (m_data + m_header->counts);
+	return true;
+}
+
+// Whether count items of the given size starting at offset fit in the file,
+// with the section suitably aligned.
+static bool Fits(uint64_t offset, uint64_t count, uint64_t size,
+				 uint64_t fileSize)
+{
+	return offset % 8 == 0 && offset <= fileSize &&
+		count <= (fileSize - offset) / size;
+}
+
+// Whether offsets[0..count] start at 0, never decrease, and end at no more
+// than limit.
+static bool Increasing(const uint64_t* offsets, uint64_t count, uint64_t limit)
+{
+	if (offsets[0] != 0 || offsets[count] > limit)
+		return false;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		if (offsets[i] > offsets[i + 1])
+			return false;
+	}
+	return true;
+}
+
+bool CsrFile::Check() const
+{
+	const CsrHeader& h = *m_header;
+	if (memcmp(h.magic, CSR_MAGIC, sizeof(h.magic)) != 0 ||
+		h.version != CSR_VERSION || (h.flags & ~(CSR_WEIGHTS | CSR_HASHED)) != 0 ||
+		h.fileSize != m_size)
+		return false;
+
+	// every row and (unhashed) column takes at least 8 bytes, so these can't
+	// overflow when adding one to them; hashed columns are a power of two
+	bool hashed = (h.flags & CSR_HASHED) != 0;
+	if (h.rows >= m_size || (!hashed && h.columns >= m_size) || 
+		h.columns > 0xffffffffull ||
+		(hashed && (h.columns < 2 || (h.columns & (h.columns - 1)) != 0)))
+		return false;
+
+	if (h.titleOffset > m_size || h.titleLength > m_size - h.titleOffset ||
+		!Fits(h.termOffsets, hashed ? 1 : h.columns + 1, 8, m_size) ||
+		!Fits(h.nameOffsets, h.rows + 1, 8, m_size) ||
+		!Fits(h.rowPointers, h.rows + 1, 8, m_size) ||
+		!Fits(h.columnIndices, h.nonZeros, 4, m_size) ||
+		!Fits(h.counts, h.nonZeros, 4, m_size) ||
+		h.termText > m_size || h.nameText > m_size)
+		return false;
+
+	const uint64_t* termOffsets = (const uint64_t*) (m_data + h.termOffsets);
+	const uint64_t* nameOffsets = (const uint64_t*) (m_data + h.nameOffsets);
+	const uint64_t* rowPointers = (const uint64_t*) (m_data + h.rowPointers);
+	const uint32_t* columns = (const uint32_t*) (m_data + h.columnIndices);
+	if ((hashed && termOffsets[0] > 0xffffffffull) ||
+		(!hashed && !Increasing(termOffsets, h.columns, m_size - h.termText)) ||
+		!Increasing(nameOffsets, h.rows, m_size - h.nameText) ||
+		!Increasing(rowPointers, h.rows, h.nonZeros) ||
+		rowPointers[h.rows] != h.nonZeros)
+		return false;
+
+	// each row's columns have to be in range and strictly increasing
+	for (uint64_t row = 0; row < h.rows; row++)
+	{
+		for (uint64_t i = rowPointers[row]; i < rowPointers[row + 1]; i++)
+		{
+			if (columns[i] >= h.columns ||
+				(i > rowPointers[row] && columns[i] <= columns[i - 1]))
+				return false;
+		}
+	}
+	return true;
+}
+
+string_view CsrFile::Title() const
+{
+	return string_view(m_data + m_header->titleOffset, m_header->titleLength);
+}
+
+string_view CsrFile::Term(uint64_t column) const
+{
+	if (Hashed())
+		return string_view();
+	return string_view(m_data + m_header->termText + m_termOffsets[column],
+		m_termOffsets[column + 1] - m_termOffsets[column]);
+}
+
+string_view CsrFile::Name(uint64_t row) const
+{
+	return string_view(m_data + m_header->nameText + m_nameOffsets[row],
+		m_nameOffsets[row + 1] - m_nameOffsets[row]);
+}
+
+bool CsrFile::Load(TermDictionary& dictionary, DocumentTable& documents) const
+{
+	for (uint64_t column = 0; !Hashed() && column < Columns(); column++)
+	{
+		string_view term = Term(column);
+		if (dictionary.Intern(term.data(), term.size()) != column)
+			return false;
+	}
+
+	for (uint64_t row = 0; row < Rows(); row++)
+	{
+		documents.BeginDocument(Name(row));
+		for (uint64_t i = m_rowPointers[row]; i < m_rowPointers[row + 1]; i++)
+			documents.AddTerm(m_columns[i], Weighted() ? 1 : m_counts[i]);
+		documents.EndDocument();
+	}
+	return true;
+}
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// csr.h
+///////////////////////////////////////////////////////////////////////////////
+// A binary alternative to the .edsf/.edmf text formats (--format=csr): the
+// dimension mapping and every datapoint in one file, laid out so that a
+// consumer can mmap it and use the arrays in place.
+//
+// The datapoints are stored as a compressed sparse row matrix with a row per
+// document and a column per dimension.  Row r's non-zero entries are
+// columns[rowPointers[r] .. rowPointers[r+1]) with the same range of counts,
+// ordered by column.
+//
+// Layout of a .csr file.  Every integer is little endian and every section
+// starts on an 8 byte boundary; the header gives the offset of each section
+// from the start of the file.
+//
+//     header          CsrHeader
+//     title           titleLength bytes, the collection's name
+//     term offsets    uint64[columns + 1], where each word starts in term text
+//     term text       the words of dimensions 0, 1, 2, ... run together
+//     name offsets    uint64[rows + 1], where each name starts in name text
+//     name text       the document names run together
+//     row pointers    uint64[rows + 1]
+//     columns         uint32[nonZeros]
+//     counts          uint32[nonZeros], or float32[nonZeros] of weights if
+//                     flags has CSR_WEIGHTS (see weight.h)
+//
+// With CSR_HASHED in flags the columns are hashed dimensions (see
+// hashdims.h), of which there are a power of two.  They have no words, and
+// there are usually far more of them than non-zero entries, so the term
+// offsets are just a single uint64, the seed they were hashed with, and the
+// term text is empty.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef CSR_H
+#define CSR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class TermDictionary;
+class DocumentTable;
+class DocumentReader;
+class Weigher;
+class FeatureHasher;
+
+struct CsrHeader
+{
+	char magic[8];			// "SPASMCSR"
+	uint32_t version;		// CSR_VERSION
+	uint32_t flags;			// CSR_WEIGHTS and/or CSR_HASHED, or 0
+	uint64_t rows;
+	uint64_t columns;
+	uint64_t nonZeros;
+	uint64_t titleOffset;
+	uint64_t titleLength;
+	uint64_t termOffsets;
+	uint64_t termText;
+	uint64_t nameOffsets;
+	uint64_t nameText;
+	uint64_t rowPointers;
+	uint64_t columnIndices;
+	uint64_t counts;
+	uint64_t fileSize;
+};
+
+const uint32_t CSR_VERSION = 1;
+const uint32_t CSR_WEIGHTS = 1;
+const uint32_t CSR_HASHED = 2;
+
+// Writes filename with a row for each document documents reads (see
+// spill.h) and a column for each dimension: dimension d is the word
+// dictionary->Term(order[d]), or, if dictionary is NULL, one of hasher's
+// hashed dimensions.  The values are the counts, or the weights from weigher
+// if it isn't NULL.  Returns false if the file can't be written.
+bool WriteCsr(const std::string& filename, const std::string& title,
+	const TermDictionary* dictionary, const std::vector<unsigned int>& order,
+	const FeatureHasher* hasher, DocumentReader& documents,
+	const Weigher* weigher);
+
+// A .csr file, mapped read only.
+class CsrFile
+{
+public:
+	CsrFile();
+	~CsrFile();
+
+	// Maps filename and checks that it is a well formed .csr file.  Returns
+	// false if it can't be read or isn't one.
+	bool Open(const char* filename);
+	void Close();
+
+	uint64_t Rows() const { return m_header->rows; }
+	uint64_t Columns() const { return m_header->columns; }
+	uint64_t NonZeros() const { return m_header->nonZeros; }
+
+	std::string_view Title() const;
+	// The word of a column; always empty if the file is Hashed().
+	std::string_view Term(uint64_t column) const;
+	std::string_view Name(uint64_t row) const;
+
+	const uint64_t* RowPointers() const { return m_rowPointers; }
+	const uint32_t* ColumnIndices() const { return m_columns; }
+	// The values are Counts(), unless the file holds Weights().
+	bool Weighted() const { return (m_header->flags & CSR_WEIGHTS) != 0; }
+	bool Hashed() const { return (m_header->flags & CSR_HASHED) != 0; }
+	const uint32_t* Counts() const { return m_counts; }
+	const float* Weights() const { return (const float*) m_counts; }
+	// The seed a Hashed() file's dimensions were hashed with.
+	uint32_t HashSeed() const
+		{ return Hashed() ? (uint32_t) m_termOffsets[0] : 0; }
+
+	// Adds every word to dictionary, in column order, and every row to
+	// documents; the rows of a Hashed() file hold hashed dimensions, so
+	// documents should have SparseTerms().  Documents can't hold Weights(),
+	// so the rows of a Weighted() file go in with every count 1.  Returns
+	// false if a word appears twice, or dictionary already had words in it,
+	// so that column c wouldn't be term id c.
+	bool Load(TermDictionary& dictionary, DocumentTable& documents) const;
+
+private:
+	bool Check() const;
+
+	const char* m_data;
+	size_t m_size;
+	const CsrHeader* m_header;
+	const uint64_t* m_termOffsets;
+	const uint64_t* m_nameOffsets;
+	const uint64_t* m_rowPointers;
+	const uint32_t* m_columns;
+	const uint32_t* m_counts;
+
+	// not copyable: it owns the mapping
+	CsrFile(const CsrFile&);
+	CsrFile& operator=(const CsrFile&);
+};
+
+#endif
@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////////
+// docfreq.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Counting document frequencies and pruning by them.  See docfreq.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "docfreq.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+using namespace std;
+
+bool FrequencyLimit::Parse(const char* text)
+{
+	char* end;
+	double number = strtod(text, &end);
+	if (end == text || *end != '\0' || number < 0)
+		return false;
+
+	fraction = strchr(text, '.') != NULL;
+	if (fraction && number > 1)
+		return false;
+	value = number;
+	return true;
+}
+
+DocumentFrequencies::DocumentFrequencies()
+{
+	m_enabled = false;
+	m_sparse = false;
+	m_counters = 0;
+}
+
+void DocumentFrequencies::Approximate(size_t counters)
+{
+	m_enabled = true;
+	m_counters = max(counters, (size_t) 1);
+	m_heap.reserve(m_counters);
+}
+
+unsigned int DocumentFrequencies::Frequency(unsigned int term) const
+{
+	if (m_counters > 0)
+	{
+		unordered_map<unsigned int, size_t>::const_iterator i =
+			m_index.find(term);
+		return i == m_index.end() ? 0 : m_heap[i->second].count;
+	}
+	if (m_sparse)
+	{
+		unordered_map<unsigned int, unsigned int>::const_iterator i =
+			m_sparseExact.find(term);
+		return i == m_sparseExact.end() ? 0 : i->second;
+	}
+	return term < m_exact.size() ? m_exact[term] : 0;
+}
+
+void DocumentFrequencies::Counted(vector<unsigned int>& terms) const
+{
+	terms.clear();
+	if (m_counters > 0)
+	{
+		for (size_t i = 0; i < m_heap.size(); i++)
+			terms.push_back(m_heap[i].term);
+	}
+	else if (m_sparse)
+	{
+		for (unordered_map<unsigned int, unsigned int>::const_iterator i =
+			m_sparseExact.begin(); i != m_sparseExact.end(); i++)
+			terms.push_back(i->first);
+	}
+	else
+	{
+		for (unsigned int term = 0; term < m_exact.size(); term++)
+		{
+			if (m_exact[term] > 0)
+				terms.push_back(term);
+		}
+	}
+	sort(terms.begin(), terms.end());
+}
+
+// Restores the heap below counter i after its count went up.
+void DocumentFrequencies::SiftDown(size_t i)
+{
+	while (true)
+	{
+		size_t smallest = i;
+		size_t left = 2 * i + 1, right = left + 1;
+		if (left < m_heap.size() && m_heap[left].count < m_heap[smallest].count)
+			smallest = left;
+		if (right < m_heap.size() &&
+			m_heap[right].count < m_heap[smallest].count)
+			smallest = right;
+		if (smallest == i)
+			return;
+
+		swap(m_heap[i], m_heap[smallest]);
+		m_index[m_heap[i].term] = i;
+		m_index[m_heap[smallest].term] = smallest;
+		i = smallest;
+	}
+}
+
+void DocumentFrequencies::CountApproximately(unsigned int term)
+{
+	unordered_map<unsigned int, size_t>::iterator i = m_index.find(term);
+	if (i != m_index.end())
+	{
+		m_heap[i->second].count++;
+		SiftDown(i->second);
+		return;
+	}
+
+	if (m_heap.size() < m_counters)
+	{
+		// a new count of 1 is no bigger than any other, so it belongs at the
+		// top of the heap
+		Counter counter = { term, 1 };
+		m_heap.push_back(counter);
+		size_t j = m_heap.size() - 1;
+		while (j > 0 && m_heap[(j - 1) / 2].count > 1)
+		{
+			swap(m_heap[j], m_heap[(j - 1) / 2]);
+			m_index[m_heap[j].term] = j;
+			j = (j - 1) / 2;
+		}
+		m_index[term] = j;
+		return;
+	}
+
+	// take over the least frequent term's counter
+	m_index.erase(m_heap[0].term);
+	m_heap[0].term = term;
+	m_heap[0].count++;
+	m_index[term] = 0;
+	SiftDown(0);
+}
+
+// Orders positions in the order being pruned by decreasing frequency, and
+// then by position.
+class MoreFrequent
+{
+public:
+	MoreFrequent(const vector<unsigned int>& frequency)
+		: m_frequency(frequency) {}
+
+	bool operator()(size_t a, size_t b) const
+	{
+		if (m_frequency[a] != m_frequency[b])
+			return m_frequency[a] > m_frequency[b];
+		return a < b;
+	}
+
+private:
+	const vector<unsigned int>& m_frequency;
+};
+
+void DocumentFrequencies::Prune(vector<unsigned int>& order, size_t documents,
+								const FrequencyLimit& minimum,
+								const FrequencyLimit& maximum,
+								size_t maxFeatures) const
+{
+	double low = minimum.Documents(documents);
+	double high = maximum.Documents(documents);
+
+	vector<unsigned int> kept, frequency;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		unsigned int f = Frequency(order[i]);
+		// terms that aren't counted approximately didn't make the cut
+		if (f >= low && f <= high && (m_counters == 0 || f > 0))
+		{
+			kept.push_back(order[i]);
+			frequency.push_back(f);
+		}
+	}
+
+	if (maxFeatures > 0 && kept.size() > maxFeatures)
+	{
+		vector<size_t> positions(kept.size());
+		for (size_t i = 0; i < positions.size(); i++)
+			positions[i] = i;
+		nth_element(positions.begin(), positions.begin() + maxFeatures,
+			positions.end(), MoreFrequent(frequency));
+		positions.resize(maxFeatures);
+		sort(positions.begin(), positions.end());
+
+		for (size_t i = 0; i < positions.size(); i++)
+			kept[i] = kept[positions[i]];
+		kept.resize(maxFeatures);
+	}
+	order.swap(kept);
+}
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// docfreq.h
+///////////////////////////////////////////////////////////////////////////////
+// Document frequencies (how many documents each term occurs in), counted as
+// each document is finished, and pruning the vocabulary by them before
+// dimensions are assigned (--min-df, --max-df and --max-features).
+//
+// Frequencies are normally counted exactly, with a counter per term.  With
+// --approximate-df only the terms that could make the --max-features cut
+// are counted, using the Space-Saving algorithm: a fixed number of counters
+// is kept, and a term that isn't counted yet takes over the counter of the
+// least frequent one, starting from that counter's value.  A term's count
+// can only be an overestimate, and by no more than the smallest count, so
+// the terms that really are frequent are always among those kept.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef DOCFREQ_H
+#define DOCFREQ_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "termdict.h"
+
+// A --min-df or --max-df limit: a number of documents, or a fraction of
+// them.
+class FrequencyLimit
+{
+public:
+	double value;
+	bool fraction;
+
+	FrequencyLimit() : value(0), fraction(false) {};
+	FrequencyLimit(double value, bool fraction)
+		: value(value), fraction(fraction) {};
+
+	// Reads "N" (documents) or "0.N" (a fraction of the documents).
+	bool Parse(const char* text);
+
+	// The limit as a number of documents, out of documents.
+	double Documents(size_t documents) const
+		{ return fraction ? value * documents : value; }
+};
+
+class DocumentFrequencies
+{
+public:
+	DocumentFrequencies();
+
+	// Starts counting exactly.  Sparse counting keeps a counter for each
+	// term that has been seen, rather than for every term id up to the
+	// largest seen, for term ids spread over a huge range such as hashed
+	// dimensions.
+	void Enable(bool sparse = false)
+		{ m_enabled = true; m_sparse = sparse; }
+
+	// Starts counting approximately, with the given number of counters.
+	void Approximate(size_t counters);
+
+	bool Enabled() const { return m_enabled; }
+	bool Exact() const { return m_counters == 0; }
+
+	// Counts each term of a finished document's sparse vector once.
+	void Count(const TermCount* begin, const TermCount* end)
+	{
+		if (!m_enabled)
+			return;
+		for (const TermCount* entry = begin; entry != end; entry++)
+		{
+			if (m_counters > 0)
+				CountApproximately(entry->term);
+			else if (m_sparse)
+				m_sparseExact[entry->term]++;
+			else
+			{
+				if (entry->term >= m_exact.size())
+					m_exact.resize(std::max((size_t) entry->term + 1,
+						m_exact.size() * 2), 0);
+				m_exact[entry->term]++;
+			}
+		}
+	}
+
+	// How many documents term occurred in (an overestimate, or 0 if it isn't
+	// among those counted, when counting approximately).
+	unsigned int Frequency(unsigned int term) const;
+
+	// Fills terms with every term that has been counted, in increasing
+	// order.
+	void Counted(std::vector<unsigned int>& terms) const;
+
+	// Removes from order, which holds term ids, every term that occurs in
+	// fewer than minimum or more than maximum of the given number of
+	// documents, and then all but the maxFeatures most frequent of the rest
+	// (0 for no limit).  Ties go to the term earlier in order.  What's left
+	// stays in the same order.
+	void Prune(std::vector<unsigned int>& order, size_t documents,
+		const FrequencyLimit& minimum, const FrequencyLimit& maximum,
+		size_t maxFeatures) const;
+
+private:
+	void CountApproximately(unsigned int term);
+	void SiftDown(size_t i);
+
+	bool m_enabled;
+	bool m_sparse;
+	std::vector<unsigned int> m_exact;		// term -> frequency
+	std::unordered_map<unsigned int, unsigned int> m_sparseExact;
+
+	// Space-Saving: a min-heap of counters by count, and where each counted
+	// term's counter is in it.
+	struct Counter
+	{
+		unsigned int term;
+		unsigned int count;
+	};
+	size_t m_counters;
+	std::vector<Counter> m_heap;
+	std::unordered_map<unsigned int, size_t> m_index;
+};
+
+#endif
@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////////////
+// english.cpp
+///////////////////////////////////////////////////////////////////////////////
+// The Snowball English stemmer ("Porter2"), Martin Porter's revision of his
+// original algorithm (which is still in porter.cpp).  It follows the
+// published description step by step:
+//     http://snowball.tartarus.org/algorithms/english/stemmer.html
+// See snowball.h for what the stemmers have in common.
+///////////////////////////////////////////////////////////////////////////////
+#include "stemmer.h"
+#include "snowball.h"
+
+static bool IsVowel(char32_t c)
+{
+	return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' ||
+		c == 'y';
+}
+
+// A short syllable ends just before end: a vowel followed by a non-vowel
+// other than w, x or Y and preceded by a non-vowel, or a vowel at the start
+// of the word followed by a non-vowel.
+static bool ShortSyllable(const SnowballWord& w, int end)
+{
+	if (end >= 3 && !IsVowel(w[end - 1]) && w[end - 1] != 'w' &&
+		w[end - 1] != 'x' && w[end - 1] != 'Y' && IsVowel(w[end - 2]) &&
+		!IsVowel(w[end - 3]))
+		return true;
+	return end == 2 && IsVowel(w[0]) && !IsVowel(w[1]);
+}
+
+// Whether there is a vowel before end.
+static bool VowelBefore(const SnowballWord& w, int end)
+{
+	for (int i = 0; i < end; i++)
+	{
+		if (IsVowel(w[i]))
+			return true;
+	}
+	return false;
+}
+
+// Words that are changed, or left alone, as a whole.
+struct Exception
+{
+	const char32_t* word;
+	const char32_t* stem;
+};
+
+static const Exception EXCEPTIONS[] = {
+	{ U"skis", U"ski" }, { U"skies", U"sky" }, { U"dying", U"die" },
+	{ U"lying", U"lie" }, { U"tying", U"tie" }, { U"idly", U"idl" },
+	{ U"gently", U"gentl" }, { U"ugly", U"ugli" }, { U"early", U"earli" },
+	{ U"only", U"onli" }, { U"singly", U"singl" }, { U"sky", U"sky" },
+	{ U"news", U"news" }, { U"howe", U"howe" }, { U"atlas", U"atlas" },
+	{ U"cosmos", U"cosmos" }, { U"bias", U"bias" }, { U"andes", U"andes" }
+};
+
+// Left as they are once step 1a has taken their plurals off.
+static const char32_t* const INVARIANTS[] = { U"inning", U"outing",
+	U"canning", U"herring", U"earring", U"proceed", U"exceed", U"succeed" };
+
+static const Suffix STEP0[] = { { U"'", 0 }, { U"'s", 0 }, { U"'s'", 0 } };
+
+enum { SSES, IES, S, US };
+static const Suffix STEP1A[] = { { U"sses", SSES }, { U"ied", IES },
+	{ U"ies", IES }, { U"s", S }, { U"us", US }, { U"ss", US } };
+
+enum { EED, ED };
+static const Suffix STEP1B[] = { { U"eed", EED }, { U"eedly", EED },
+	{ U"ed", ED }, { U"edly", ED }, { U"ing", ED }, { U"ingly", ED } };
+
+// Steps 2 and 3 replace each suffix with the text of its rule; OGI, LI and
+// ATIVE have conditions of their own.
+static const char32_t* const REPLACEMENTS[] = { U"tion", U"ence", U"ance",
+	U"able", U"ent", U"ize", U"ate", U"al", U"ful", U"ous", U"ive", U"ble",
+	U"less", U"ic", U"" };
+enum { TION, ENCE, ANCE, ABLE, ENT, IZE, ATE, AL, FUL, OUS, IVE, BLE, LESS,
+	IC, DELETE, OGI, LI, ATIVE };
+
+static const Suffix STEP2[] = { { U"tional", TION }, { U"enci", ENCE },
+	{ U"anci", ANCE }, { U"abli", ABLE }, { U"entli", ENT }, { U"izer", IZE },
+	{ U"ization", IZE }, { U"ational", ATE }, { U"ation", ATE },
+	{ U"ator", ATE }, { U"alism", AL }, { U"aliti", AL }, { U"alli", AL },
+	{ U"fulness", FUL }, { U"ousli", OUS }, { U"ousness", OUS },
+	{ U"iveness", IVE }, { U"iviti", IVE }, { U"biliti", BLE },
+	{ U"bli", BLE }, { U"ogi", OGI }, { U"fulli", FUL }, { U"lessli", LESS },
+	{ U"li", LI } };
+
+static const Suffix STEP3[] = { { U"tional", TION }, { U"ational", ATE },
+	{ U"alize", AL }, { U"icate", IC }, { U"iciti", IC }, { U"ical", IC },
+	{ U"ful", DELETE }, { U"ness", DELETE }, { U"ative", ATIVE } };
+
+enum { REMOVE, ION };
+static const Suffix STEP4[] = { { U"al", REMOVE }, { U"ance", REMOVE },
+	{ U"ence", REMOVE }, { U"er", REMOVE }, { U"ic", REMOVE },
+	{ U"able", REMOVE }, { U"ible", REMOVE }, { U"ant", REMOVE },
+	{ U"ement", REMOVE }, { U"ment", REMOVE }, { U"ent", REMOVE },
+	{ U"ism", REMOVE }, { U"ate", REMOVE }, { U"iti", REMOVE },
+	{ U"ous", REMOVE }, { U"ive", REMOVE }, { U"ize", REMOVE },
+	{ U"ion", ION } };
+
+class English : public Stemmer
+{
+public:
+	size_t Stem(char* word, size_t length) const;
+	const char* Name() const { return "english"; }
+
+private:
+	static void Steps(SnowballWord& w);
+};
+
+size_t English::Stem(char* word, size_t length) const
+{
+	SnowballWord w;
+	if (!w.Load(word, length))
+		return length;
+
+	for (const Exception& exception : EXCEPTIONS)
+	{
+		if (w.Equals(exception.word))
+		{
+			w.SetEnd(0, exception.stem);
+			return w.Store(word, length);
+		}
+	}
+	if (w.Size() <= 2)
+		return length;
+
+	// an initial apostrophe goes, and a y at the start or after a vowel is
+	// a consonant, Y
+	if (w[0] == '\'')
+		w.Replace(0, 1, U"");
+	if (w.Size() > 0 && w[0] == 'y')
+		w.Set(0, 'Y');
+	for (int i = 1; i < w.Size(); i++)
+	{
+		if (w[i] == 'y' && IsVowel(w[i - 1]))
+			w.Set(i, 'Y');
+	}
+
+	Steps(w);
+
+	for (int i = 0; i < w.Size(); i++)
+	{
+		if (w[i] == 'Y')
+			w.Set(i, 'y');
+	}
+	return w.Store(word, length);
+}
+
+void English::Steps(SnowballWord& w)
+{
+	int p1;
+	if (w.StartsWith(U"gener") || w.StartsWith(U"arsen"))
+		p1 = 5;
+	else if (w.StartsWith(U"commun"))
+		p1 = 6;
+	else
+		p1 = w.AfterVowelConsonant(0, IsVowel);
+	int p2 = w.AfterVowelConsonant(p1, IsVowel);
+	int start;
+
+	// Step 0: apostrophes
+	if (w.Longest(STEP0, SUFFIXES(STEP0), 0, start) >= 0)
+		w.Truncate(start);
+
+	// Step 1a: plurals
+	switch (w.Longest(STEP1A, SUFFIXES(STEP1A), 0, start))
+	{
+	case SSES:
+		w.SetEnd(start, U"ss");
+		break;
+	case IES:
+		w.SetEnd(start, start > 1 ? U"i" : U"ie");
+		break;
+	case S:
+		if (VowelBefore(w, start - 1))
+			w.Truncate(start);
+		break;
+	}
+
+	for (const char32_t* invariant : INVARIANTS)
+	{
+		if (w.Equals(invariant))
+			return;
+	}
+
+	// Step 1b: -ed and -ing
+	switch (w.Longest(STEP1B, SUFFIXES(STEP1B), 0, start))
+	{
+	case EED:
+		if (start >= p1)
+			w.SetEnd(start, U"ee");
+		break;
+	case ED:
+		if (!VowelBefore(w, start))
+			break;
+		w.Truncate(start);
+		if (w.EndsWith(U"at") || w.EndsWith(U"bl") || w.EndsWith(U"iz"))
+			w.SetEnd(w.Size(), U"e");
+		else if (w.Size() >= 2 && w[w.Size() - 1] == w[w.Size() - 2] &&
+			OneOf(U"bdfgmnprt", w[w.Size() - 1]))
+			w.Truncate(w.Size() - 1);
+		else if (w.Size() == p1 && ShortSyllable(w, w.Size()))
+			w.SetEnd(w.Size(), U"e");
+		break;
+	}
+
+	// Step 1c: y to i after a consonant that isn't the first letter
+	if (w.Size() > 2 && (w[w.Size() - 1] == 'y' || w[w.Size() - 1] == 'Y') &&
+		!IsVowel(w[w.Size() - 2]))
+		w.Set(w.Size() - 1, 'i');
+
+	// Step 2
+	int rule = w.Longest(STEP2, SUFFIXES(STEP2), 0, start);
+	if (rule >= 0 && start >= p1)
+	{
+		if (rule == OGI)
+		{
+			if (start > 0 && w[start - 1] == 'l')
+				w.SetEnd(start, U"og");
+		}
+		else if (rule == LI)
+		{
+			if (start > 0 && OneOf(U"cdeghkmnrt", w[start - 1]))
+				w.Truncate(start);
+		}
+		else
+			w.SetEnd(start, REPLACEMENTS[rule]);
+	}
+
+	// Step 3
+	rule = w.Longest(STEP3, SUFFIXES(STEP3), 0, start);
+	if (rule >= 0 && start >= p1)
+	{
+		if (rule != ATIVE)
+			w.SetEnd(start, REPLACEMENTS[rule]);
+		else if (start >= p2)
+			w.Truncate(start);
+	}
+
+	// Step 4
+	rule = w.Longest(STEP4, SUFFIXES(STEP4), 0, start);
+	if (rule >= 0 && start >= p2 && (rule == REMOVE ||
+		(start > 0 && (w[start - 1] == 's' || w[start - 1] == 't'))))
+		w.Truncate(start);
+
+	// Step 5: a final e or l
+	start = w.Size() - 1;
+	if (start >= 0 && w[start] == 'e' &&
+		(start >= p2 || (start >= p1 && !ShortSyllable(w, start))))
+		w.Truncate(start);
+	else if (start > 0 && w[start] == 'l' && start >= p2 &&
+		w[start - 1] == 'l')
+		w.Truncate(start);
+}
+
+const Stemmer& EnglishStemmer()
+{
+	static const English english;
+	return english;
+}
@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////////////
+// french.cpp
+///////////////////////////////////////////////////////////////////////////////
+// The Snowball French stemmer, following the published description:
+//     http://snowball.tartarus.org/algorithms/french/stemmer.html
+// See snowball.h for what the stemmers have in common.
+//
+// The source is kept to ASCII, so accented letters are written as \u
+// escapes: 00e0 a-grave, 00e2 a-circumflex, 00e7 c-cedilla, 00e8 e-grave,
+// 00e9 e-acute, 00ea e-circumflex, 00eb e-diaeresis, 00ee i-circumflex,
+// 00ef i-diaeresis, 00f4 o-circumflex, 00f9 u-grave and 00fb u-circumflex.
+///////////////////////////////////////////////////////////////////////////////
+#include "stemmer.h"
+#include "snowball.h"
+
+static const char32_t C_CEDILLA = 0xe7, E_GRAVE = 0xe8, E_ACUTE = 0xe9;
+
+static bool IsVowel(char32_t c)
+{
+	return OneOf(U"aeiouy\u00e2\u00e0\u00eb\u00e9\u00ea\u00e8\u00ef\u00ee"
+		U"\u00f4\u00fb\u00f9", c);
+}
+
+// What a final s is kept after.
+static bool KeepWithS(char32_t c) { return OneOf(U"aiou\u00e8s", c); }
+
+// Step 1: standard suffixes
+enum { ANCE, ATRICE, LOGIE, USION, ENCE, EMENT, ITE, IF, EAUX, AUX, EUSE,
+	ISSEMENT, AMMENT, EMMENT, MENT };
+static const Suffix STANDARD[] = { { U"ance", ANCE }, { U"iqUe", ANCE },
+	{ U"isme", ANCE }, { U"able", ANCE }, { U"iste", ANCE }, { U"eux", ANCE },
+	{ U"ances", ANCE }, { U"iqUes", ANCE }, { U"ismes", ANCE },
+	{ U"ables", ANCE }, { U"istes", ANCE }, { U"atrice", ATRICE },
+	{ U"ateur", ATRICE }, { U"ation", ATRICE }, { U"atrices", ATRICE },
+	{ U"ateurs", ATRICE }, { U"ations", ATRICE }, { U"logie", LOGIE },
+	{ U"logies", LOGIE }, { U"usion", USION }, { U"ution", USION },
+	{ U"usions", USION }, { U"utions", USION }, { U"ence", ENCE },
+	{ U"ences", ENCE }, { U"ement", EMENT }, { U"ements", EMENT },
+	{ U"it\u00e9", ITE }, { U"it\u00e9s", ITE }, { U"if", IF },
+	{ U"ive", IF }, { U"ifs", IF }, { U"ives", IF }, { U"eaux", EAUX },
+	{ U"aux", AUX }, { U"euse", EUSE }, { U"euses", EUSE },
+	{ U"issement", ISSEMENT }, { U"issements", ISSEMENT },
+	{ U"amment", AMMENT }, { U"emment", EMMENT }, { U"ment", MENT },
+	{ U"ments", MENT } };
+
+enum { IV, EUS, ABL, IER };
+static const Suffix AFTER_EMENT[] = { { U"iv", IV }, { U"eus", EUS },
+	{ U"abl", ABL }, { U"iqU", ABL }, { U"i\u00e8r", IER },
+	{ U"I\u00e8r", IER } };
+
+enum { ABIL, IC, ITE_IV };
+static const Suffix AFTER_ITE[] = { { U"abil", ABIL }, { U"ic", IC },
+	{ U"iv", ITE_IV } };
+
+// Step 2a: verb suffixes beginning with i
+static const Suffix I_VERB[] = { { U"\u00eemes", 0 }, { U"\u00eet", 0 },
+	{ U"\u00eetes", 0 }, { U"i", 0 }, { U"ie", 0 }, { U"ies", 0 },
+	{ U"ir", 0 }, { U"ira", 0 }, { U"irai", 0 }, { U"iraIent", 0 },
+	{ U"irais", 0 }, { U"irait", 0 }, { U"iras", 0 }, { U"irent", 0 },
+	{ U"irez", 0 }, { U"iriez", 0 }, { U"irions", 0 }, { U"irons", 0 },
+	{ U"iront", 0 }, { U"is", 0 }, { U"issaIent", 0 }, { U"issais", 0 },
+	{ U"issait", 0 }, { U"issant", 0 }, { U"issante", 0 },
+	{ U"issantes", 0 }, { U"issants", 0 }, { U"isse", 0 }, { U"issent", 0 },
+	{ U"isses", 0 }, { U"issez", 0 }, { U"issiez", 0 }, { U"issions", 0 },
+	{ U"issons", 0 }, { U"it", 0 } };
+
+// Step 2b: other verb suffixes
+enum { IONS, VERB, A };
+static const Suffix VERB_SUFFIXES[] = { { U"ions", IONS }, { U"\u00e9", VERB },
+	{ U"\u00e9e", VERB }, { U"\u00e9es", VERB }, { U"\u00e9s", VERB },
+	{ U"\u00e8rent", VERB }, { U"er", VERB }, { U"era", VERB },
+	{ U"erai", VERB }, { U"eraIent", VERB }, { U"erais", VERB },
+	{ U"erait", VERB }, { U"eras", VERB }, { U"erez", VERB },
+	{ U"eriez", VERB }, { U"erions", VERB }, { U"erons", VERB },
+	{ U"eront", VERB }, { U"ez", VERB }, { U"iez", VERB },
+	{ U"\u00e2mes", A }, { U"\u00e2t", A }, { U"\u00e2tes", A }, { U"a", A },
+	{ U"ai", A }, { U"aIent", A }, { U"ais", A }, { U"ait", A }, { U"ant", A },
+	{ U"ante", A }, { U"antes", A }, { U"ants", A }, { U"as", A },
+	{ U"asse", A }, { U"assent", A }, { U"asses", A }, { U"assiez", A },
+	{ U"assions", A } };
+
+// Step 4: residual suffixes
+enum { ION, IERE, E, E_DIAERESIS };
+static const Suffix RESIDUAL[] = { { U"ion", ION }, { U"ier", IERE },
+	{ U"i\u00e8re", IERE }, { U"Ier", IERE }, { U"I\u00e8re", IERE },
+	{ U"e", E }, { U"\u00eb", E_DIAERESIS } };
+
+static const Suffix DOUBLES[] = { { U"enn", 0 }, { U"onn", 0 },
+	{ U"ett", 0 }, { U"ell", 0 }, { U"eill", 0 } };
+
+class French : public Stemmer
+{
+public:
+	size_t Stem(char* word, size_t length) const;
+	const char* Name() const { return "french"; }
+
+private:
+	struct Regions
+	{
+		int pV, p1, p2;
+	};
+
+	static bool StandardSuffix(SnowballWord& w, const Regions& r);
+	static bool IVerbSuffix(SnowballWord& w, const Regions& r);
+	static bool VerbSuffix(SnowballWord& w, const Regions& r);
+	static void ResidualSuffix(SnowballWord& w, const Regions& r);
+};
+
+size_t French::Stem(char* word, size_t length) const
+{
+	SnowballWord w;
+	if (!w.Load(word, length))
+		return length;
+
+	// u or i between vowels, y next to a vowel and u after q are
+	// consonants, U, I and Y
+	for (int i = 0; i < w.Size(); )
+	{
+		bool next = i + 1 < w.Size();
+		if (next && IsVowel(w[i]) && w[i + 1] == 'u' && i + 2 < w.Size() &&
+			IsVowel(w[i + 2]))
+			w.Set(i + 1, 'U');
+		else if (next && IsVowel(w[i]) && w[i + 1] == 'i' &&
+			i + 2 < w.Size() && IsVowel(w[i + 2]))
+			w.Set(i + 1, 'I');
+		else if (next && IsVowel(w[i]) && w[i + 1] == 'y')
+			w.Set(i + 1, 'Y');
+		else if (next && w[i] == 'y' && IsVowel(w[i + 1]))
+			w.Set(i, 'Y');
+		else if (next && w[i] == 'q' && w[i + 1] == 'u')
+			w.Set(i + 1, 'U');
+		else
+			i++;
+	}
+
+	// RV starts after the third letter if the word starts with two vowels
+	// (or par, col or tap), and otherwise after the first vowel that isn't
+	// the first letter
+	Regions r;
+	r.pV = w.Size();
+	if (w.Size() >= 3 && ((IsVowel(w[0]) && IsVowel(w[1])) ||
+		w.StartsWith(U"par") || w.StartsWith(U"col") || w.StartsWith(U"tap")))
+		r.pV = 3;
+	else
+	{
+		for (int i = 1; i < w.Size(); i++)
+		{
+			if (IsVowel(w[i]))
+			{
+				r.pV = i + 1;
+				break;
+			}
+		}
+	}
+	r.p1 = w.AfterVowelConsonant(0, IsVowel);
+	r.p2 = w.AfterVowelConsonant(r.p1, IsVowel);
+
+	if (StandardSuffix(w, r) || IVerbSuffix(w, r) || VerbSuffix(w, r))
+	{
+		// Step 3
+		int last = w.Size() - 1;
+		if (last >= 0 && w[last] == 'Y')
+			w.Set(last, 'i');
+		else if (last >= 0 && w[last] == C_CEDILLA)
+			w.Set(last, 'c');
+	}
+	else
+	{
+		ResidualSuffix(w, r);
+	}
+
+	// Step 5: undouble
+	int start;
+	if (w.Longest(DOUBLES, SUFFIXES(DOUBLES), 0, start) >= 0)
+		w.Truncate(w.Size() - 1);
+
+	// Step 6: unaccent an e before the final consonants
+	int i = w.Size() - 1;
+	while (i >= 0 && !IsVowel(w[i]))
+		i--;
+	if (i >= 0 && i < w.Size() - 1 && (w[i] == E_ACUTE || w[i] == E_GRAVE))
+		w.Set(i, 'e');
+
+	for (i = 0; i < w.Size(); i++)
+	{
+		switch (w[i])
+		{
+		case 'I': w.Set(i, 'i'); break;
+		case 'U': w.Set(i, 'u'); break;
+		case 'Y': w.Set(i, 'y'); break;
+		}
+	}
+	return w.Store(word, length);
+}
+
+// Returns false, sometimes after changing the word, if step 2 should be
+// tried.
+bool French::StandardSuffix(SnowballWord& w, const Regions& r)
+{
+	int start, rule = w.Longest(STANDARD, SUFFIXES(STANDARD), 0, start);
+	int next;
+	switch (rule)
+	{
+	case ANCE:
+		if (start < r.p2)
+			return false;
+		w.Truncate(start);
+		return true;
+
+	case ATRICE:
+		if (start < r.p2)
+			return false;
+		w.Truncate(start);
+		if (w.EndsWith(U"ic"))
+			w.SetEnd(w.Size() - 2, w.Size() - 2 >= r.p2 ? U"" : U"iqU");
+		return true;
+
+	case LOGIE:
+	case USION:
+	case ENCE:
+		if (start < r.p2)
+			return false;
+		w.SetEnd(start, rule == LOGIE ? U"log" : rule == USION ? U"u" :
+			U"ent");
+		return true;
+
+	case EMENT:
+		if (start < r.pV)
+			return false;
+		w.Truncate(start);
+		switch (w.Longest(AFTER_EMENT, SUFFIXES(AFTER_EMENT), 0, next))
+		{
+		case IV:
+			if (next >= r.p2)
+			{
+				w.Truncate(next);
+				if (w.EndsWith(U"at") && w.Size() - 2 >= r.p2)
+					w.Truncate(w.Size() - 2);
+			}
+			break;
+		case EUS:
+			if (next >= r.p2)
+				w.Truncate(next);
+			else if (next >= r.p1)
+				w.SetEnd(next, U"eux");
+			break;
+		case ABL:
+			if (next >= r.p2)
+				w.Truncate(next);
+			break;
+		case IER:
+			if (next >= r.pV)
+				w.SetEnd(next, U"i");
+			break;
+		}
+		return true;
+
+	case ITE:
+		if (start < r.p2)
+			return false;
+		w.Truncate(start);
+		switch (w.Longest(AFTER_ITE, SUFFIXES(AFTER_ITE), 0, next))
+		{
+		case ABIL:
+			w.SetEnd(next, next >= r.p2 ? U"" : U"abl");
+			break;
+		case IC:
+			w.SetEnd(next, next >= r.p2 ? U"" : U"iqU");
+			break;
+		case ITE_IV:
+			if (next >= r.p2)
+				w.Truncate(next);
+			break;
+		}
+		return true;
+
+	case IF:
+		if (start < r.p2)
+			return false;
+		w.Truncate(start);
+		if (w.EndsWith(U"at") && w.Size() - 2 >= r.p2)
+		{
+			w.Truncate(w.Size() - 2);
+			if (w.EndsWith(U"ic"))
+				w.SetEnd(w.Size() - 2, w.Size() - 2 >= r.p2 ? U"" : U"iqU");
+		}
+		return true;
+
+	case EAUX:
+		w.SetEnd(start, U"eau");
+		return true;
+
+	case AUX:
+		if (start < r.p1)
+			return false;
+		w.SetEnd(start, U"al");
+		return true;
+
+	case EUSE:
+		if (start >= r.p2)
+			w.Truncate(start);
+		else if (start >= r.p1)
+			w.SetEnd(start, U"eux");
+		else
+			return false;
+		return true;
+
+	case ISSEMENT:
+		if (start < r.p1 || start == 0 || IsVowel(w[start - 1]))
+			return false;
+		w.Truncate(start);
+		return true;
+
+	// the rest change the word, but still go on to step 2
+	case AMMENT:
+		if (start >= r.pV)
+			w.SetEnd(start, U"ant");
+		return false;
+	case EMMENT:
+		if (start >= r.pV)
+			w.SetEnd(start, U"ent");
+		return false;
+	case MENT:
+		if (start - 1 >= r.pV && IsVowel(w[start - 1]))
+			w.Truncate(start);
+		return false;
+	}
+	return false;
+}
+
+// Suffixes of verbs, which are only looked for in RV.
+bool French::IVerbSuffix(SnowballWord& w, const Regions& r)
+{
+	int start;
+	if (w.Longest(I_VERB, SUFFIXES(I_VERB), r.pV, start) < 0 ||
+		start - 1 < r.pV || IsVowel(w[start - 1]))
+		return false;
+	w.Truncate(start);
+	return true;
+}
+
+bool French::VerbSuffix(SnowballWord& w, const Regions& r)
+{
+	int start;
+	switch (w.Longest(VERB_SUFFIXES, SUFFIXES(VERB_SUFFIXES), r.pV, start))
+	{
+	case IONS:
+		if (start < r.p2)
+			return false;
+		w.Truncate(start);
+		return true;
+	case VERB:
+		w.Truncate(start);
+		return true;
+	case A:
+		w.Truncate(start);
+		if (start - 1 >= r.pV && w[start - 1] == 'e')
+			w.Truncate(start - 1);
+		return true;
+	}
+	return false;
+}
+
+void French::ResidualSuffix(SnowballWord& w, const Regions& r)
+{
+	int size = w.Size();
+	if (size >= 2 && w[size - 1] == 's' && !KeepWithS(w[size - 2]))
+		w.Truncate(size - 1);
+
+	int start;
+	switch (w.Longest(RESIDUAL, SUFFIXES(RESIDUAL), r.pV, start))
+	{
+	case ION:
+		if (start >= r.p2 && start - 1 >= r.pV &&
+			(w[start - 1] == 's' || w[start - 1] == 't'))
+			w.Truncate(start);
+		break;
+	case IERE:
+		w.SetEnd(start, U"i");
+		break;
+	case E:
+		w.Truncate(start);
+		break;
+	case E_DIAERESIS:
+		if (start - 2 >= r.pV && w[start - 2] == 'g' && w[start - 1] == 'u')
+			w.Truncate(start);
+		break;
+	}
+}
+
+const Stemmer& FrenchStemmer()
+{
+	static const French french;
+	return french;
+}
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// german.cpp
+///////////////////////////////////////////////////////////////////////////////
+// The Snowball German stemmer, following the published description:
+//     http://snowball.tartarus.org/algorithms/german/stemmer.html
+// See snowball.h for what the stemmers have in common.
+///////////////////////////////////////////////////////////////////////////////
+#include "stemmer.h"
+#include "snowball.h"
+
+// The source is kept to ASCII, so the letters with umlauts are escaped.
+static const char32_t A_UMLAUT = 0xe4, O_UMLAUT = 0xf6, U_UMLAUT = 0xfc,
+	SHARP_S = 0xdf;
+
+static bool IsVowel(char32_t c)
+{
+	return OneOf(U"aeiouy\u00e4\u00f6\u00fc", c);
+}
+
+// What can come before a final -s, or -st.
+static bool IsSEnding(char32_t c) { return OneOf(U"bdfghklmnrt", c); }
+static bool IsStEnding(char32_t c) { return OneOf(U"bdfghklmnt", c); }
+
+enum { EM, E, S };
+static const Suffix STEP1[] = { { U"em", EM }, { U"ern", EM }, { U"er", EM },
+	{ U"e", E }, { U"en", E }, { U"es", E }, { U"s", S } };
+
+enum { EN, ST };
+static const Suffix STEP2[] = { { U"en", EN }, { U"er", EN }, { U"est", EN },
+	{ U"st", ST } };
+
+enum { END, IG, LICH, KEIT };
+static const Suffix STEP3[] = { { U"end", END }, { U"ung", END },
+	{ U"ig", IG }, { U"ik", IG }, { U"isch", IG }, { U"lich", LICH },
+	{ U"heit", LICH }, { U"keit", KEIT } };
+
+static const Suffix AFTER_KEIT[] = { { U"lich", 0 }, { U"ig", 0 } };
+
+class German : public Stemmer
+{
+public:
+	size_t Stem(char* word, size_t length) const;
+	const char* Name() const { return "german"; }
+
+private:
+	static void Steps(SnowballWord& w, int p1, int p2);
+};
+
+size_t German::Stem(char* word, size_t length) const
+{
+	SnowballWord w;
+	if (!w.Load(word, length))
+		return length;
+
+	// sharp s is ss, and u and y between vowels are consonants, U and Y
+	for (int i = 0; i < w.Size(); i++)
+	{
+		if (w[i] == SHARP_S && !w.Replace(i, i + 1, U"ss"))
+			return length;
+	}
+	for (int i = 1; i + 1 < w.Size(); i++)
+	{
+		if ((w[i] == 'u' || w[i] == 'y') && IsVowel(w[i - 1]) &&
+			IsVowel(w[i + 1]))
+			w.Set(i, w[i] == 'u' ? 'U' : 'Y');
+	}
+
+	// R1 starts at least 3 letters in.  R2 is found from where R1 would
+	// have started without that.
+	int p1 = w.Size(), p2 = w.Size();
+	if (w.Size() >= 3)
+	{
+		int after = w.AfterVowelConsonant(0, IsVowel);
+		if (after < w.Size())
+		{
+			p1 = after < 3 ? 3 : after;
+			p2 = w.AfterVowelConsonant(after, IsVowel);
+		}
+	}
+	Steps(w, p1, p2);
+
+	for (int i = 0; i < w.Size(); i++)
+	{
+		switch (w[i])
+		{
+		case 'U': w.Set(i, 'u'); break;
+		case 'Y': w.Set(i, 'y'); break;
+		case A_UMLAUT: w.Set(i, 'a'); break;
+		case O_UMLAUT: w.Set(i, 'o'); break;
+		case U_UMLAUT: w.Set(i, 'u'); break;
+		}
+	}
+	return w.Store(word, length);
+}
+
+void German::Steps(SnowballWord& w, int p1, int p2)
+{
+	int start;
+
+	// Step 1
+	switch (w.Longest(STEP1, SUFFIXES(STEP1), 0, start))
+	{
+	case EM:
+		if (start >= p1)
+			w.Truncate(start);
+		break;
+	case E:
+		if (start >= p1)
+		{
+			w.Truncate(start);
+			if (w.EndsWith(U"niss"))
+				w.Truncate(w.Size() - 1);
+		}
+		break;
+	case S:
+		if (start >= p1 && start > 0 && IsSEnding(w[start - 1]))
+			w.Truncate(start);
+		break;
+	}
+
+	// Step 2
+	switch (w.Longest(STEP2, SUFFIXES(STEP2), 0, start))
+	{
+	case EN:
+		if (start >= p1)
+			w.Truncate(start);
+		break;
+	case ST:
+		// after an st-ending that has at least 3 letters before it
+		if (start >= p1 && start >= 4 && IsStEnding(w[start - 1]))
+			w.Truncate(start);
+		break;
+	}
+
+	// Step 3: derivational suffixes
+	int rule = w.Longest(STEP3, SUFFIXES(STEP3), 0, start);
+	if (rule < 0 || start < p2)
+		return;
+	switch (rule)
+	{
+	case END:
+		w.Truncate(start);
+		if (w.EndsWith(U"ig") && w.Size() - 2 >= p2 &&
+			(w.Size() == 2 || w[w.Size() - 3] != 'e'))
+			w.Truncate(w.Size() - 2);
+		break;
+	case IG:
+		if (start == 0 || w[start - 1] != 'e')
+			w.Truncate(start);
+		break;
+	case LICH:
+		w.Truncate(start);
+		if ((w.EndsWith(U"er") || w.EndsWith(U"en")) && w.Size() - 2 >= p1)
+			w.Truncate(w.Size() - 2);
+		break;
+	case KEIT:
+		w.Truncate(start);
+		if (w.Longest(AFTER_KEIT, SUFFIXES(AFTER_KEIT), 0, start) >= 0 &&
+			start >= p2)
+			w.Truncate(start);
+		break;
+	}
+}
+
+const Stemmer& GermanStemmer()
+{
+	static const German german;
+	return german;
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// hashdims.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Feature hashing.  See hashdims.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "hashdims.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Dimensions are unsigned ints, and the highest one can't be NO_TERM.
+static const unsigned int MAX_HASH_BITS = 31;
+
+FeatureHasher::FeatureHasher(unsigned int bits, uint32_t seed)
+{
+	m_mask = (1u << bits) - 1;
+	m_seed = seed;
+}
+
+bool ParseHashDimensions(const char* text, unsigned int& bits)
+{
+	char* end;
+	if (strncmp(text, "2^", 2) == 0)
+	{
+		long power = strtol(text + 2, &end, 10);
+		if (end == text + 2 || *end != '\0' || power < 1 ||
+			power > (long) MAX_HASH_BITS)
+			return false;
+		bits = (unsigned int) power;
+		return true;
+	}
+
+	unsigned long long dimensions = strtoull(text, &end, 10);
+	if (end == text || *end != '\0' || dimensions < 2 ||
+		(dimensions & (dimensions - 1)) != 0 ||
+		dimensions > (1ull << MAX_HASH_BITS))
+		return false;
+
+	bits = 0;
+	while ((1ull << bits) < dimensions)
+		bits++;
+	return true;
+}
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// hashdims.h
+///////////////////////////////////////////////////////////////////////////////
+// Feature hashing (--hash-dims): instead of giving every distinct word a
+// dimension of its own, hash each word straight to one of a fixed number of
+// dimensions.  There is no term dictionary at all, so memory no longer grows
+// with the vocabulary, at the price of unrelated words sometimes sharing a
+// dimension and of the dimensions having no names.
+//
+// Words are hashed with a seeded 64 bit FNV-1a folded to 32 bits, which is
+// also what the stem cache remembers for them.  The 32 bit word hash is then
+// mixed again to pick the dimension, so n-grams, whose hashes are rolled up
+// from the word hashes (see ngram.h), are spread just as well.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef HASHDIMS_H
+#define HASHDIMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+class FeatureHasher
+{
+public:
+	// Hashes to 2^bits dimensions.
+	FeatureHasher(unsigned int bits, uint32_t seed);
+
+	unsigned int Dimensions() const { return m_mask + 1; }
+	uint32_t Seed() const { return m_seed; }
+
+	// The hash of a word.  It is never TermDictionary::NO_TERM, so it can go
+	// in a StemCache.
+	uint32_t HashWord(std::string_view word) const
+	{
+		uint64_t h = 14695981039346656037ull ^ m_seed;
+		for (size_t i = 0; i < word.size(); i++)
+		{
+			h ^= (unsigned char) word[i];
+			h *= 1099511628211ull;
+		}
+		uint32_t folded = (uint32_t) (h ^ (h >> 32));
+		return folded == 0xffffffffu ? 0xfffffffeu : folded;
+	}
+
+	// The dimension of a word, or n-gram, with the given hash.
+	unsigned int Dimension(uint64_t hash) const
+	{
+		hash = (hash ^ (hash >> 31)) * 0x7fb5d329728ea185ull;
+		hash = (hash ^ (hash >> 27)) * 0x81dadef4bc2dd44dull;
+		return (unsigned int) (hash ^ (hash >> 33)) & m_mask;
+	}
+
+private:
+	unsigned int m_mask;
+	uint32_t m_seed;
+};
+
+// Parses a number of dimensions for --hash-dims: a power of two, either
+// written out ("1048576") or as "2^20".  Sets bits to its log2.
+bool ParseHashDimensions(const char* text, unsigned int& bits);
+
+#endif
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputs.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the input file sources and prefetching.  See inputs.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "inputs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+// Adds the names read from in to names.
+static bool ReadNames(istream& in, vector<string>& names)
+{
+	string line;
+	while (getline(in, line))
+	{
+		if (line.size() > 0 && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.size() > 0)
+			names.push_back(line);
+	}
+	return !in.bad();
+}
+
+bool ReadFileList(const char* filename, vector<string>& names)
+{
+	if (strcmp(filename, "-") == 0)
+		return ReadNames(cin, names);
+
+	ifstream in(filename);
+	if (!in)
+		return false;
+	return ReadNames(in, names);
+}
+
+bool WalkDirectory(const string& directory, vector<string>& names)
+{
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL)
+		return false;
+
+	bool ok = true;
+	string path;
+	vector<string> subdirectories;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		path = directory;
+		if (path.size() == 0 || path[path.size() - 1] != '/')
+			path += '/';
+		path += entry->d_name;
+
+		// most file systems say what an entry is without a stat()
+		unsigned char type = entry->d_type;
+		struct stat info;
+		if (type == DT_UNKNOWN && lstat(path.c_str(), &info) == 0)
+		{
+			if (S_ISREG(info.st_mode))
+				type = DT_REG;
+			else if (S_ISDIR(info.st_mode))
+				type = DT_DIR;
+			else if (S_ISLNK(info.st_mode))
+				type = DT_LNK;
+		}
+		if (type == DT_LNK && stat(path.c_str(), &info) == 0 &&
+			S_ISREG(info.st_mode))
+			type = DT_REG;
+
+		if (type == DT_REG)
+			names.push_back(path);
+		else if (type == DT_DIR)
+			subdirectories.push_back(path);
+	}
+	closedir(dir);
+
+	// one directory is open at a time, however deep the tree
+	for (size_t i = 0; i < subdirectories.size(); i++)
+		ok = WalkDirectory(subdirectories[i], names) && ok;
+	return ok;
+}
+
+Prefetcher::Prefetcher(const vector<string>& filenames, unsigned int threads,
+					   size_t ahead) : m_filenames(filenames)
+{
+	m_ahead = ahead;
+	m_next = 0;
+	m_reached = 0;
+	m_stop = false;
+	if (ahead == 0 || filenames.size() < 2)
+		return;
+
+	for (unsigned int i = 0; i < threads; i++)
+		m_threads.push_back(thread(&Prefetcher::Run, this));
+}
+
+Prefetcher::~Prefetcher()
+{
+	{
+		lock_guard<mutex> lock(m_lock);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_threads.size(); i++)
+		m_threads[i].join();
+}
+
+void Prefetcher::Reached(size_t file)
+{
+	if (m_threads.empty())
+		return;
+	{
+		lock_guard<mutex> lock(m_lock);
+		if (file + 1 <= m_reached)
+			return;
+		m_reached = file + 1;
+		// the ones already being processed don't need prefetching
+		if (m_next < m_reached)
+			m_next = m_reached;
+	}
+	m_wake.notify_all();
+}
+
+void Prefetcher::Run()
+{
+	while (true)
+	{
+		size_t file;
+		{
+			unique_lock<mutex> lock(m_lock);
+			m_wake.wait(lock, [this] {
+				return m_stop || (m_next < m_filenames.size() &&
+					m_next < m_reached + m_ahead); });
+			if (m_stop)
+				return;
+			file = m_next++;
+		}
+
+		// Opening the file is often half the wait on a cold cache; the
+		// advice then starts the kernel reading all of it in the background.
+		int fd = open(m_filenames[file].c_str(), O_RDONLY);
+		if (fd < 0)
+			continue;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+}
@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputs.h
+///////////////////////////////////////////////////////////////////////////////
+// Where the input files come from, besides the command line: a list of them
+// in a file (--file-list), so that a corpus of any size can be named without
+// running into the limit on the length of a command line, or every file
+// under a directory (--recursive).
+//
+// And getting the files off the disk before they are needed.  Tokenizing a
+// file that is already in the page cache is far quicker than waiting for it
+// to be read, so a Prefetcher has a couple of threads open the next few files
+// that will be processed and ask the kernel to start reading them in
+// (posix_fadvise(POSIX_FADV_WILLNEED)), while the current ones are tokenized.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef INPUTS_H
+#define INPUTS_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Appends the names in filename, one per line, to names.  Blank lines are
+// skipped.  A filename of "-" reads the names from standard input.  Returns
+// false if it can't be read.
+bool ReadFileList(const char* filename, std::vector<std::string>& names);
+
+// Appends every regular file under directory, and its subdirectories, to
+// names.  Symbolic links to files are included, but links to directories
+// aren't followed.  Returns false if a directory can't be read.
+bool WalkDirectory(const std::string& directory,
+	std::vector<std::string>& names);
+
+class Prefetcher
+{
+public:
+	// Starts threads that prefetch filenames in order, staying at most
+	// ahead files ahead of the last one Reached().  With no threads or
+	// nothing to look ahead to, it does nothing.
+	Prefetcher(const std::vector<std::string>& filenames, unsigned int threads,
+		size_t ahead);
+
+	// Stops prefetching.
+	~Prefetcher();
+
+	// Tells the prefetcher that file (an index into filenames) is being
+	// processed, so it can go on to the ones after it.
+	void Reached(size_t file);
+
+private:
+	void Run();
+
+	const std::vector<std::string>& m_filenames;
+	size_t m_ahead;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+	size_t m_next;			// the next file to prefetch
+	size_t m_reached;		// the furthest file reached, plus one
+	bool m_stop;
+
+	// not copyable: the threads refer to it
+	Prefetcher(const Prefetcher&);
+	Prefetcher& operator=(const Prefetcher&);
+};
+
+#endif
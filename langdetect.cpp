@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// langdetect.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the language guesser.  See langdetect.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "langdetect.h"
+
+#include <stdint.h>
+#include <string.h>
+using namespace std;
+
+// Common function words that aren't also words of the other languages (so
+// no "in", "an", "die" or "des").  The accented French ones are in UTF-8.
+static const char* const ENGLISH[] = { "the", "and", "of", "to", "is",
+	"that", "it", "was", "for", "with", "as", "on", "be", "are", "this",
+	"by", "not", "he", "have", "from", "or", "which", "you", "they", "at",
+	"his", "but", "were", "been", "their", "has", "would", "there", "what",
+	"we", "will", "can", "if", "when", "who", "she", "its" };
+static const char* const GERMAN[] = { "der", "und", "den", "von", "zu",
+	"das", "mit", "sich", "auf", "f\xc3\xbcr", "ist", "im", "dem", "nicht",
+	"ein", "eine", "als", "auch", "es", "werden", "aus", "er", "hat", "dass",
+	"sie", "nach", "wird", "bei", "einer", "um", "noch", "wie", "\xc3\xbc"
+	"ber", "einen", "sind", "oder", "wurde", "ich", "zum", "zur", "kann" };
+static const char* const FRENCH[] = { "de", "la", "le", "et", "les", "en",
+	"un", "du", "une", "que", "est", "pour", "qui", "dans", "par", "plus",
+	"pas", "au", "sur", "ne", "se", "ce", "il", "sont", "avec", "\xc3\xa0",
+	"ou", "mais", "nous", "vous", "elle", "aux", "cette", "ont", "leur",
+	"\xc3\xa9t\xc3\xa9", "son", "sa", "ses", "lui", "comme", "fait" };
+
+// The function words, in an open addressed hash table that is filled in
+// once.
+class FunctionWords
+{
+public:
+	FunctionWords();
+
+	// The language word[0..length) is a function word of, or LANGUAGES.
+	Language Find(const char* word, size_t length) const;
+
+private:
+	static const size_t SLOTS = 256;	// a power of two, and well over the
+										// number of words
+	static size_t Hash(const char* word, size_t length);
+	void Add(const char* const* words, size_t count, Language language);
+
+	const char* m_words[SLOTS];
+	unsigned char m_lengths[SLOTS];
+	Language m_languages[SLOTS];
+};
+
+FunctionWords::FunctionWords()
+{
+	for (size_t i = 0; i < SLOTS; i++)
+	{
+		m_words[i] = NULL;
+		m_lengths[i] = 0;
+		m_languages[i] = LANGUAGES;
+	}
+	Add(ENGLISH, sizeof(ENGLISH) / sizeof(ENGLISH[0]), LANGUAGE_ENGLISH);
+	Add(GERMAN, sizeof(GERMAN) / sizeof(GERMAN[0]), LANGUAGE_GERMAN);
+	Add(FRENCH, sizeof(FRENCH) / sizeof(FRENCH[0]), LANGUAGE_FRENCH);
+}
+
+size_t FunctionWords::Hash(const char* word, size_t length)
+{
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+	{
+		h ^= (unsigned char) word[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+void FunctionWords::Add(const char* const* words, size_t count,
+						Language language)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t length = strlen(words[i]);
+		size_t slot = Hash(words[i], length) & (SLOTS - 1);
+		while (m_words[slot] != NULL)
+			slot = (slot + 1) & (SLOTS - 1);
+		m_words[slot] = words[i];
+		m_lengths[slot] = (unsigned char) length;
+		m_languages[slot] = language;
+	}
+}
+
+Language FunctionWords::Find(const char* word, size_t length) const
+{
+	size_t slot = Hash(word, length) & (SLOTS - 1);
+	for (; m_words[slot] != NULL; slot = (slot + 1) & (SLOTS - 1))
+	{
+		if (m_lengths[slot] == length &&
+			memcmp(m_words[slot], word, length) == 0)
+			return m_languages[slot];
+	}
+	return LANGUAGES;
+}
+
+// The language that only uses the letter whose UTF-8 encoding is 0xc3
+// followed by c, or LANGUAGES.
+static Language Accent(unsigned char c)
+{
+	switch (c)
+	{
+	case 0xa4: case 0xb6: case 0xbc:	// a, o and u with umlauts
+	case 0x84: case 0x96: case 0x9c:	// and as capitals
+	case 0x9f:							// sharp s
+		return LANGUAGE_GERMAN;
+	case 0xa0: case 0xa2: case 0xa7:	// a-grave, a-circumflex, c-cedilla
+	case 0xa8: case 0xa9: case 0xaa:	// e-grave, e-acute, e-circumflex
+	case 0xae: case 0xb4: case 0xb9:	// i and o circumflex, u-grave
+	case 0x89:							// capital e-acute
+		return LANGUAGE_FRENCH;
+	}
+	return LANGUAGES;
+}
+
+Language DetectLanguage(const char* text, size_t length)
+{
+	static const FunctionWords functionWords;
+
+	// a function word counts for more than an accent
+	unsigned int scores[LANGUAGES] = { 0, 0, 0 };
+	char word[8];
+	size_t size = 0;
+	bool skip = false;	// the word is too long to be a function word
+	for (size_t i = 0; i <= length; i++)
+	{
+		unsigned char c = i < length ? (unsigned char) text[i] : ' ';
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		if ((c >= 'a' && c <= 'z') || c >= 0x80)
+		{
+			if (c == 0xc3 && i + 1 < length)
+			{
+				Language accent = Accent((unsigned char) text[i + 1]);
+				if (accent != LANGUAGES)
+					scores[accent]++;
+			}
+			if (size == sizeof(word))
+				skip = true;
+			else
+				word[size++] = (char) c;
+			continue;
+		}
+
+		if (size > 0 && !skip)
+		{
+			Language language = functionWords.Find(word, size);
+			if (language != LANGUAGES)
+				scores[language] += 4;
+		}
+		size = 0;
+		skip = false;
+	}
+
+	Language best = LANGUAGE_ENGLISH;
+	for (int language = 0; language < LANGUAGES; language++)
+	{
+		if (scores[language] > scores[best])
+			best = (Language) language;
+	}
+	return best;
+}
+
+const char* LanguageName(Language language)
+{
+	static const char* const NAMES[LANGUAGES] = { "english", "german",
+		"french" };
+	return NAMES[language];
+}
@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+// langdetect.h
+///////////////////////////////////////////////////////////////////////////////
+// Guessing the language of a document, so that --stemmer=auto can stem each
+// one with the right stemmer.
+//
+// The guess only has to tell apart the languages there are stemmers for, so
+// it is kept as cheap as possible: it looks at the start of the document,
+// counts the words in it that are among the commonest few dozen function
+// words of each language ("the", "und", "les", ...) and the letters that
+// only one of them uses (umlauts and sharp s, or French accents), and picks
+// whichever scores highest.  A few hundred words are plenty to be sure.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef LANGDETECT_H
+#define LANGDETECT_H
+
+#include <stddef.h>
+
+enum Language
+{
+	LANGUAGE_ENGLISH,
+	LANGUAGE_GERMAN,
+	LANGUAGE_FRENCH,
+	LANGUAGES
+};
+
+// How much of the start of a document DetectLanguage() needs to see.
+const size_t DETECT_BYTES = 4096;
+
+// The language text[0..length) is most likely in.  Text with no evidence
+// either way, such as an empty document, is taken to be English.
+Language DetectLanguage(const char* text, size_t length);
+
+// "english", "german" or "french".
+const char* LanguageName(Language language);
+
+#endif
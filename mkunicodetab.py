@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+###############################################################################
+# mkunicodetab.py
+###############################################################################
+# Writes unicodetab.h, the letter and case folding tables unicode.cpp looks
+# code points up in, from the Unicode database of the Python running it.
+# Run it from the top of the tree as "python3 mkunicodetab.py" when the
+# tables should follow a newer version of Unicode.
+#
+# Every code point has a property number, which is an index into
+# UNICODE_PROPERTIES, where its class (see unicode.h) and the difference
+# between what it folds to and itself are.  The property numbers are kept in
+# rows of 128, one per block of 128 code points, and blocks with the same
+# row share it, so UNICODE_BLOCKS says which row each block uses.
+###############################################################################
+import sys
+import unicodedata
+
+BLOCK = 128
+CODE_POINTS = 0x110000
+
+OTHER, LETTER, DIGIT, SPACE = range(4)
+CLASSES = ["UNICODE_OTHER", "UNICODE_LETTER", "UNICODE_DIGIT", "UNICODE_SPACE"]
+
+# White_Space, which unicodedata doesn't have: the Zs spaces, and these
+# controls and separators
+SPACES = set(range(0x09, 0x0e)) | set([0x85, 0x2028, 0x2029])
+
+
+def properties(code):
+    c = chr(code)
+    category = unicodedata.category(c)
+    if category[0] in "LM":
+        cls = LETTER
+    elif category == "Nd":
+        return (DIGIT, 0)
+    elif category == "Zs" or code in SPACES:
+        return (SPACE, 0)
+    else:
+        return (OTHER, 0)
+
+    # simple case folding: the full folding when it's a single code point
+    # (casefold() is the full one), else plain lower casing when that is
+    folded = c.casefold()
+    if len(folded) != 1:
+        folded = c.lower()
+    if len(folded) != 1:
+        folded = c
+    return (cls, ord(folded) - code)
+
+
+def array(name, ctype, values, per_line):
+    lines = ["static const %s %s[%d] =\n{" % (ctype, name, len(values))]
+    for i in range(0, len(values), per_line):
+        lines.append("\t" + ", ".join(values[i:i + per_line]) + ",")
+    lines[-1] = lines[-1][:-1]
+    lines.append("};\n")
+    return "\n".join(lines)
+
+
+def main():
+    numbers = {}
+    rows = {}
+    blocks = []
+    for block in range(CODE_POINTS // BLOCK):
+        row = tuple(numbers.setdefault(properties(code), len(numbers))
+                    for code in range(block * BLOCK, (block + 1) * BLOCK))
+        blocks.append(rows.setdefault(row, len(rows)))
+    if len(numbers) > 256 or len(rows) > 256:
+        sys.exit("mkunicodetab.py: the tables no longer fit in bytes")
+
+    ordered = sorted(numbers, key=numbers.get)
+    rows = sorted(rows, key=rows.get)
+    out = open("unicodetab.h", "w")
+    out.write("""\
+///////////////////////////////////////////////////////////////////////////////
+// unicodetab.h
+///////////////////////////////////////////////////////////////////////////////
+// Generated by mkunicodetab.py from Unicode %s.  Don't edit it by hand.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef UNICODETAB_H
+#define UNICODETAB_H
+
+const int UNICODE_BLOCK = %d;
+
+struct UnicodeProperties
+{
+	UnicodeClass cls;
+	int fold;		// what the code point folds to, less itself
+};
+
+""" % (unicodedata.unidata_version, BLOCK))
+    out.write(array("UNICODE_PROPERTIES", "UnicodeProperties",
+                    ["{ %s, %d }" % (CLASSES[cls], fold)
+                     for cls, fold in ordered], 3))
+    out.write("\n")
+    out.write(array("UNICODE_BLOCKS", "unsigned char",
+                    [str(row) for row in blocks], 16))
+    out.write("\n")
+    out.write(array("UNICODE_ROWS", "unsigned char",
+                    [str(n) for row in rows for n in row], 16))
+    out.write("\n#endif\n")
+
+
+if __name__ == "__main__":
+    main()
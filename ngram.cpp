@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// ngram.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of n-gram counting.  See ngram.h.
+//
+// The hash of an n-gram is the polynomial sum(id_i * B^(n-1-i)) over its
+// ids (plus one, so that id 0 still counts), which rolls forward a word at a
+// time: the hash of the n-gram ending at a word is the hash of the (n-1)-gram
+// ending at the word before, times B, plus the new id.  Its top bits are
+// mixed down before picking a slot.
+///////////////////////////////////////////////////////////////////////////////
+#include "ngram.h"
+#include "hashdims.h"
+
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+
+static const uint64_t NGRAM_BASE = 0x9e3779b97f4a7c15ull;
+static const size_t INITIAL_SLOTS = 1024;
+
+bool ParseNgramRange(const char* text, int& minimum, int& maximum)
+{
+	char* end;
+	long low = strtol(text, &end, 10);
+	long high = low;
+	if (end == text)
+		return false;
+	if (strncmp(end, "..", 2) == 0)
+	{
+		const char* rest = end + 2;
+		high = strtol(rest, &end, 10);
+		if (end == rest)
+			return false;
+	}
+	if (*end != '\0' || low < 1 || high < low || high > MAX_NGRAM)
+		return false;
+
+	minimum = (int) low;
+	maximum = (int) high;
+	return true;
+}
+
+NgramCounter::NgramCounter(int minimum, int maximum)
+{
+	m_minimum = minimum;
+	m_maximum = maximum;
+	m_length = 0;
+	m_hashes[0] = 0;
+	m_used = 0;
+
+	Slot empty;
+	memset(&empty, 0, sizeof(empty));
+	empty.term = TermDictionary::NO_TERM;
+	m_slots.assign(INITIAL_SLOTS, empty);
+}
+
+static size_t SlotOf(uint64_t hash, size_t mask)
+{
+	return (size_t) ((hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ull >> 32) & mask;
+}
+
+// Moves the window on to word, and rolls the hashes forward.
+void NgramCounter::Roll(unsigned int word)
+{
+	for (int i = 0; i + 1 < MAX_NGRAM; i++)
+		m_window[i] = m_window[i + 1];
+	m_window[MAX_NGRAM - 1] = word;
+	if (m_length < MAX_NGRAM)
+		m_length++;
+
+	// roll the hashes forward, longest first so each uses the old shorter one
+	for (int n = MAX_NGRAM; n >= 1; n--)
+		m_hashes[n] = m_hashes[n - 1] * NGRAM_BASE + word + 1;
+}
+
+void NgramCounter::Add(unsigned int word, TermDictionary& dictionary,
+					   DocumentTable& documents)
+{
+	Roll(word);
+	if (m_minimum == 1)
+		documents.AddTerm(word);
+
+	int longest = m_length < m_maximum ? m_length : m_maximum;
+	for (int n = m_minimum > 2 ? m_minimum : 2; n <= longest; n++)
+	{
+		documents.AddTerm(Find(m_window + MAX_NGRAM - n, n, m_hashes[n],
+			dictionary));
+	}
+}
+
+void NgramCounter::AddHashed(uint32_t word, const FeatureHasher& hasher,
+							 DocumentTable& documents)
+{
+	Roll(word);
+	if (m_minimum == 1)
+		documents.AddTerm(hasher.Dimension(word));
+
+	// with the length mixed in, as for the table below
+	int longest = m_length < m_maximum ? m_length : m_maximum;
+	for (int n = m_minimum > 2 ? m_minimum : 2; n <= longest; n++)
+		documents.AddTerm(hasher.Dimension(m_hashes[n] + n));
+}
+
+// Returns the term id of the n-gram ids[0..n), interning its text into
+// dictionary if it hasn't been seen before.
+unsigned int NgramCounter::Find(const unsigned int* ids, int n, uint64_t hash,
+								TermDictionary& dictionary)
+{
+	// the length is part of the key, since a trigram could hash like a bigram
+	hash += n;
+	size_t mask = m_slots.size() - 1;
+	size_t i = SlotOf(hash, mask);
+	while (m_slots[i].term != TermDictionary::NO_TERM)
+	{
+		const Slot& slot = m_slots[i];
+		if (slot.hash == hash && memcmp(slot.ids, ids, n * sizeof(*ids)) == 0 &&
+			(n == MAX_NGRAM || slot.ids[n] == TermDictionary::NO_TERM))
+			return slot.term;
+		i = (i + 1) & mask;
+	}
+
+	// the first time: put the text together, with a space between words
+	TermDictionary& words = Words(dictionary);
+	m_text.clear();
+	for (int k = 0; k < n; k++)
+	{
+		if (k > 0)
+			m_text += ' ';
+		m_text.append(words.Term(ids[k]));
+	}
+
+	Slot& slot = m_slots[i];
+	slot.hash = hash;
+	for (int k = 0; k < MAX_NGRAM; k++)
+		slot.ids[k] = k < n ? ids[k] : TermDictionary::NO_TERM;
+	slot.term = dictionary.Intern(m_text.data(), m_text.size());
+	unsigned int term = slot.term;
+
+	if (++m_used * 2 > m_slots.size())
+		Grow();
+	return term;
+}
+
+void NgramCounter::Grow()
+{
+	vector<Slot> old;
+	old.swap(m_slots);
+
+	Slot empty;
+	memset(&empty, 0, sizeof(empty));
+	empty.term = TermDictionary::NO_TERM;
+	m_slots.assign(old.size() * 2, empty);
+
+	size_t mask = m_slots.size() - 1;
+	for (size_t j = 0; j < old.size(); j++)
+	{
+		if (old[j].term == TermDictionary::NO_TERM)
+			continue;
+		size_t i = SlotOf(old[j].hash, mask);
+		while (m_slots[i].term != TermDictionary::NO_TERM)
+			i = (i + 1) & mask;
+		m_slots[i] = old[j];
+	}
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// ngram.h
+///////////////////////////////////////////////////////////////////////////////
+// Counting n-grams (--ngrams): runs of two or three consecutive words, after
+// normalizing, stemming and removing stop words, counted as terms in their
+// own right alongside (or instead of) the single words.
+//
+// An n-gram is identified by the term ids of its words, not by its text.
+// The NgramCounter keeps a rolling hash of the ids of the n-grams ending at
+// the current word, so finding the term id of an n-gram that has been seen
+// before is one hash table probe and comparing two or three integers.  Only
+// the first time an n-gram is seen is its text ("new york") put together and
+// interned into the term dictionary, so n-grams and words share dimensions
+// and everything downstream treats them the same.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NGRAM_H
+#define NGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "termdict.h"
+
+class FeatureHasher;
+
+const int MAX_NGRAM = 3;
+
+// Parses "N" or "M..N", with 1 <= M <= N <= MAX_NGRAM.  Returns false if it
+// isn't one of those.
+bool ParseNgramRange(const char* text, int& minimum, int& maximum);
+
+class NgramCounter
+{
+public:
+	// Counts the n-grams of minimum to maximum words.
+	NgramCounter(int minimum, int maximum);
+
+	// The dictionary the words themselves should be interned into, given the
+	// one the terms that are counted go into.  Unless single words are
+	// counted, it is a dictionary of the counter's own, so that words only
+	// used to make up n-grams don't become dimensions.
+	TermDictionary& Words(TermDictionary& dictionary)
+		{ return m_minimum == 1 ? dictionary : m_words; }
+
+	// Starts a new document: no n-gram spans two documents.
+	void Reset() { m_length = 0; }
+
+	// Adds the word with the given id in Words(dictionary) to documents, if
+	// single words are counted, and then every n-gram ending at it.
+	void Add(unsigned int word, TermDictionary& dictionary,
+		DocumentTable& documents);
+
+	// The same for --hash-dims, given the word's hash rather than an id.  The
+	// n-grams are hashed straight to their dimensions too.
+	void AddHashed(uint32_t word, const FeatureHasher& hasher,
+		DocumentTable& documents);
+
+private:
+	void Roll(unsigned int word);
+
+	struct Slot
+	{
+		uint64_t hash;
+		unsigned int ids[MAX_NGRAM];
+		unsigned int term;		// TermDictionary::NO_TERM when empty
+	};
+
+	unsigned int Find(const unsigned int* ids, int n, uint64_t hash,
+		TermDictionary& dictionary);
+	void Grow();
+
+	int m_minimum;
+	int m_maximum;
+	TermDictionary m_words;
+
+	// the last MAX_NGRAM words, oldest first, and the hash of the n-gram of
+	// the last n of them in m_hashes[n]
+	unsigned int m_window[MAX_NGRAM];
+	uint64_t m_hashes[MAX_NGRAM + 1];
+	int m_length;
+
+	std::vector<Slot> m_slots;		// a power of two, at most half full
+	size_t m_used;
+	std::string m_text;
+};
+
+#endif
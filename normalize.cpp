@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////
+// normalize.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the token normalization policies.  See normalize.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "normalize.h"
+#include "charclass.h"
+#include "unicode.h"
+
+#include <string.h>
+using namespace std;
+
+bool ParsePunctuationPolicy(const char* name, PunctuationPolicy& policy)
+{
+	if (strcmp(name, "split") == 0)
+		policy = PUNCT_SPLIT;
+	else if (strcmp(name, "drop") == 0)
+		policy = PUNCT_DROP;
+	else if (strcmp(name, "keep") == 0)
+		policy = PUNCT_KEEP;
+	else if (strcmp(name, "legacy") == 0)
+		policy = PUNCT_LEGACY;
+	else
+		return false;
+	return true;
+}
+
+static inline bool IsDigit(unsigned char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool IsJoiner(unsigned char c)
+{
+	return c == '\'' || c == '-';
+}
+
+TokenNormalizer::TokenNormalizer(PunctuationPolicy policy, bool keepDigits)
+{
+	m_policy = policy;
+	m_keepDigits = keepDigits;
+}
+
+inline bool TokenNormalizer::IsWordChar(unsigned char c) const
+{
+	return IsAlpha(c) || (m_keepDigits && IsDigit(c));
+}
+
+// Looks at the character at the start of text[0..length), which mustn't be
+// empty: sets size to the number of bytes it takes and folded to what it 
+// case folds to, and returns UNICODE_LETTER if it is part of words (kept
+// digits included), UNICODE_SPACE if it is a space, and UNICODE_OTHER if it
+// is punctuation.  ASCII is dealt with directly, and only the rest is
+// decoded and looked up.  A byte that doesn't start a valid UTF-8 character
+// is a character of its own, and punctuation.
+inline UnicodeClass TokenNormalizer::NextChar(const char* text, 
+	size_t length, size_t& size, char32_t& folded) const
+{
+	unsigned char c = text[0];
+	if (c < 0x80)
+	{
+		size = 1;
+		folded = ToLower(c);
+		if (IsWordChar(c))
+			return UNICODE_LETTER;
+		return IsSpace(c) ? UNICODE_SPACE : UNICODE_OTHER;
+	}
+
+	char32_t code;
+	size = DecodeUtf8(text, length, code);
+	if (size == 0)
+	{
+		size = 1;
+		return UNICODE_OTHER;
+	}
+	UnicodeClass cls = FoldCodePoint(code, folded);
+	if (cls == UNICODE_DIGIT)
+		return m_keepDigits ? UNICODE_LETTER : UNICODE_OTHER;
+	return cls;
+}
+
+void TokenNormalizer::Split(string_view token, vector<string_view>& pieces) 
+	const
+{
+	pieces.clear();
+	if (m_policy == PUNCT_LEGACY)
+	{
+		pieces.push_back(token);
+		return;
+	}
+
+	// The tokenizer only splits at ASCII whitespace, so other spaces always
+	// separate words here too.  Splitting at punctuation separates them at
+	// anything else that isn't part of a word as well.
+	const char* p = token.data();
+	size_t length = token.size();
+	size_t start = 0;
+	size_t i = 0;
+	while (i < length)
+	{
+		// the other policies only have to look at what isn't ASCII
+		if (m_policy != PUNCT_SPLIT && (unsigned char) p[i] < 0x80 &&
+			!IsSpace(p[i]))
+		{
+			i++;
+			continue;
+		}
+
+		size_t size;
+		char32_t folded;
+		UnicodeClass cls = NextChar(p + i, length - i, size, folded);
+		if (cls == UNICODE_SPACE || 
+			(m_policy == PUNCT_SPLIT && cls != UNICODE_LETTER))
+		{
+			if (i > start)
+				pieces.push_back(string_view(p + start, i - start));
+			start = i + size;
+		}
+		i += size;
+	}
+	if (i > start)
+		pieces.push_back(string_view(p + start, i - start));
+}
+
+string_view TokenNormalizer::Normalize(string_view piece, string& buffer) 
+	const
+{
+	if (buffer.size() < Room(piece.size()))
+		buffer.resize(Room(piece.size()));
+	return Normalize(piece, &buffer[0]);
+}
+
+string_view TokenNormalizer::Normalize(string_view piece, char* out) const
+{
+	const char* in = piece.data();
+	size_t length = piece.size();
+
+	size_t i = 0;
+	while (i < length && IsLower(in[i]))
+		i++;
+	if (i == length)
+		return piece;
+
+	i = GetCharKernels().LowerLetters(in, length, out);
+	size_t n = i;
+
+	if (m_policy == PUNCT_LEGACY)
+	{
+		// RemovePunct() erased the 10 characters starting at each character
+		// that wasn't a letter, and then skipped over the character that 
+		// moved into its place without looking at it.
+		while (i < length)
+		{
+			if (IsAlpha(in[i]))
+			{
+				out[n++] = ToLower(in[i]);
+				i++;
+			}
+			else
+			{
+				i += 10;
+				if (i < length)
+				{
+					out[n++] = ToLower(in[i]);
+					i++;
+				}
+			}
+		}
+		return string_view(out, n);
+	}
+
+	bool word = i > 0;	// whether the last character was part of a word
+	while (i < length)
+	{
+		size_t size;
+		char32_t folded;
+		if (NextChar(in + i, length - i, size, folded) == UNICODE_LETTER)
+		{
+			if (folded < 0x80)
+				out[n++] = (char) folded;
+			else
+				n += EncodeUtf8(folded, out + n);
+			word = true;
+		}
+		else
+		{
+			size_t next;
+			if (m_policy == PUNCT_KEEP && IsJoiner(in[i]) && word && 
+				i + 1 < length && NextChar(in + i + 1, length - i - 1, next, 
+				folded) == UNICODE_LETTER)
+				out[n++] = in[i];
+			word = false;
+		}
+		i += size;
+	}
+	return string_view(out, n);
+}
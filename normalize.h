@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// normalize.h
+///////////////////////////////////////////////////////////////////////////////
+// Turns the raw tokens from the Tokenizer into the words that are counted.
+//
+// Tokens are UTF-8.  Letters are those of any script (see unicode.h), and
+// words are case folded, which for ASCII is just lower casing.  The spaces
+// the tokenizer doesn't split at, those beyond ASCII such as no-break or
+// ideographic spaces, separate words just the same.  What happens to the
+// punctuation in a token (anything else that isn't a letter, including
+// bytes that aren't valid UTF-8) is up to a PunctuationPolicy:
+//
+//   split   punctuation separates words ("e-mail" -> "e", "mail")
+//   drop    punctuation is removed ("don't" -> "dont", "e-mail" -> "email")
+//   keep    apostrophes and hyphens between two letters are kept ("don't",
+//           "e-mail"); any other punctuation is removed
+//   legacy  what RemovePunct() used to do, which was to erase the ten
+//           characters starting at each punctuation mark ("don't" -> "don",
+//           "e-mail" -> "e").  Only useful for matching old output, so it
+//           treats every byte that isn't an ASCII letter as punctuation,
+//           just as RemovePunct() did.
+//
+// Digits (of any script) are punctuation unless keepDigits is set, in which
+// case they are treated just like letters.
+//
+// Everything is done in one pass over the token, and a token that is already
+// nothing but lower case ASCII letters is passed through without being
+// copied.  The leading run of ASCII letters of any other token is lower
+// cased by the vectorized LowerLetters() kernel (see charclass.h), and only
+// the characters after it are looked at one at a time.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "unicode.h"
+
+enum PunctuationPolicy
+{
+	PUNCT_SPLIT,
+	PUNCT_DROP,
+	PUNCT_KEEP,
+	PUNCT_LEGACY
+};
+
+// Parses the name of a policy ("split", "drop", "keep" or "legacy").
+// Returns false if it isn't one.
+bool ParsePunctuationPolicy(const char* name, PunctuationPolicy& policy);
+
+class TokenNormalizer
+{
+public:
+	TokenNormalizer(PunctuationPolicy policy, bool keepDigits);
+
+	// Fills pieces with the parts of token that each become a word.  Spaces
+	// other than the ASCII ones the tokenizer splits at (such as no-break
+	// and ideographic spaces) always separate pieces, except with the legacy
+	// policy; otherwise, unless the policy is to split on punctuation, the
+	// piece is just token itself.  Pieces point into token.
+	void Split(std::string_view token, std::vector<std::string_view>& pieces)
+		const;
+
+	// Case folds a piece and deals with its punctuation.  The result is 
+	// either piece itself, if it didn't need changing, or is written into 
+	// buffer.
+	std::string_view Normalize(std::string_view piece, std::string& buffer)
+		const;
+
+	// The same, writing into out, which must have room for Room(piece.size())
+	// bytes.
+	std::string_view Normalize(std::string_view piece, char* out) const;
+
+	// Case folding makes a few characters a byte longer, but never more than
+	// half as long again.
+	static size_t Room(size_t length) { return length + length / 2; }
+
+private:
+	bool IsWordChar(unsigned char c) const;
+	UnicodeClass NextChar(const char* text, size_t length, size_t& size, 
+		char32_t& folded) const;
+
+	PunctuationPolicy m_policy;
+	bool m_keepDigits;
+};
+
+#endif
@@ -26,6 +26,8 @@
 
 #include <string.h>  /* for memmove */
 
+#include "porter.h"
+
 #define TRUE 1
 #define FALSE 0
 
@@ -37,22 +39,34 @@
 
    Note that only lower case sequences are stemmed. Forcing to lower case
    should be done before stem(...) is called.
+
+   b, k, k0 and j are kept together in a struct stemmer that lives on the
+   stack of stem(), rather than in statics, so that any number of threads
+   can be stemming their own words at the same time and nothing is ever
+   allocated.
 */
 
-static char * b;       /* buffer for word to be stemmed */
-static int k,k0,j;     /* j is a general offset into the string */
+struct stemmer {
+   char * b;       /* buffer for word to be stemmed */
+   int k;          /* offset to the end of the string */
+   int k0;         /* offset to the start of the string */
+   int j;          /* a general offset into the string */
+   unsigned long long c; /* bit i set <=> b[k0+i] is a consonant; only
+                            kept by the table-driven suffix phase below */
+   int masked;     /* TRUE once c has been worked out */
+};
 
-/* cons(i) is TRUE <=> b[i] is a consonant. */
+/* cons(z, i) is TRUE <=> b[i] is a consonant. */
 
-static int cons(int i)
-{  switch (b[i])
+static int cons(struct stemmer * z, int i)
+{  switch (z->b[i])
    {  case 'a': case 'e': case 'i': case 'o': case 'u': return FALSE;
-      case 'y': return (i==k0) ? TRUE : !cons(i-1);
+      case 'y': return (i==z->k0) ? TRUE : !cons(z, i-1);
       default: return TRUE;
    }
 }
 
-/* m() measures the number of consonant sequences between k0 and j. if c is
+/* m(z) measures the number of consonant sequences between k0 and j. if c is
    a consonant sequence and v a vowel sequence, and <..> indicates arbitrary
    presence,
 
@@ -63,47 +77,55 @@ static int cons(int i)
       ....
 */
 
-static int m()
+static int m(struct stemmer * z)
 {  int n = 0;
-   int i = k0;
+   int i = z->k0;
+   int j = z->j;
    while(TRUE)
    {  if (i > j) return n;
-      if (! cons(i)) break; i++;
+      if (! cons(z, i)) break; i++;
    }
    i++;
    while(TRUE)
    {  while(TRUE)
       {  if (i > j) return n;
-            if (cons(i)) break;
+            if (cons(z, i)) break;
             i++;
       }
       i++;
       n++;
       while(TRUE)
       {  if (i > j) return n;
-         if (! cons(i)) break;
+         if (! cons(z, i)) break;
          i++;
       }
       i++;
    }
 }
 
-/* vowelinstem() is TRUE <=> k0,...j contains a vowel */
+/* vowelinstem(z) is TRUE <=> k0,...j contains a vowel */
 
-static int vowelinstem()
-{  int i; for (i = k0; i <= j; i++) if (! cons(i)) return TRUE;
+static int vowelinstem(struct stemmer * z)
+{  int i; for (i = z->k0; i <= z->j; i++) if (! cons(z, i)) return TRUE;
    return FALSE;
 }
 
-/* doublec(j) is TRUE <=> j,(j-1) contain a double consonant. */
+/* ascii(z, i) is TRUE <=> b[i] is an ASCII character. The bytes of a UTF-8
+   character beyond ASCII count as consonants in measuring a word, but
+   doublec() and cvc() never match them, so that the last two bytes of, say,
+   E4 BA BA aren't taken for a double consonant and one of them cut off. */
+
+#define ascii(z, i) (((z)->b[i] & 0x80) == 0)
+
+/* doublec(z, j) is TRUE <=> j,(j-1) contain a double consonant. */
 
-static int doublec(int j)
-{  if (j < k0+1) return FALSE;
-   if (b[j] != b[j-1]) return FALSE;
-   return cons(j);
+static int doublec(struct stemmer * z, int j)
+{  if (j < z->k0+1) return FALSE;
+   if (z->b[j] != z->b[j-1] || !ascii(z, j)) return FALSE;
+   return cons(z, j);
 }
 
-/* cvc(i) is TRUE <=> i-2,i-1,i has the form consonant - vowel - consonant
+/* cvc(z, i) is TRUE <=> i-2,i-1,i has the form consonant - vowel - consonant
    and also if the second c is not w,x or y. this is used when trying to
    restore an e at the end of a short word. e.g.
 
@@ -112,39 +134,43 @@ static int doublec(int j)
 
 */
 
-static int cvc(int i)
-{  if (i < k0+2 || !cons(i) || cons(i-1) || !cons(i-2)) return FALSE;
-   {  int ch = b[i];
+static int cvc(struct stemmer * z, int i)
+{  if (i < z->k0+2 || !cons(z, i) || cons(z, i-1) || !cons(z, i-2)) return FALSE;
+   if (!ascii(z, i) || !ascii(z, i-2)) return FALSE;
+   {  int ch = z->b[i];
       if (ch == 'w' || ch == 'x' || ch == 'y') return FALSE;
    }
    return TRUE;
 }
 
-/* ends(s) is TRUE <=> k0,...k ends with the string s. */
+/* ends(z, s) is TRUE <=> k0,...k ends with the string s. */
 
-static int ends(char * s)
+static int ends(struct stemmer * z, const char * s)
 {  int length = s[0];
+   char * b = z->b;
+   int k = z->k;
    if (s[length] != b[k]) return FALSE; /* tiny speed-up */
-   if (length > k-k0+1) return FALSE;
+   if (length > k-z->k0+1) return FALSE;
    if (memcmp(b+k-length+1,s+1,length) != 0) return FALSE;
-   j = k-length;
+   z->j = k-length;
    return TRUE;
 }
 
-/* setto(s) sets (j+1),...k to the characters in the string s, readjusting
+/* setto(z, s) sets (j+1),...k to the characters in the string s, readjusting
    k. */
 
-static void setto(char * s)
+static void setto(struct stemmer * z, const char * s)
 {  int length = s[0];
-   memmove(b+j+1,s+1,length);
-   k = j+length;
+   int j = z->j;
+   memmove(z->b+j+1,s+1,length);
+   z->k = j+length;
 }
 
-/* r(s) is used further down. */
+/* r(z, s) is used further down. */
 
-static void r(char * s) { if (m() > 0) setto(s); }
+static void r(struct stemmer * z, const char * s) { if (m(z) > 0) setto(z, s); }
 
-/* step1ab() gets rid of plurals and -ed or -ing. e.g.
+/* step1ab(z) gets rid of plurals and -ed or -ing. e.g.
 
        caresses  ->  caress
        ponies    ->  poni
@@ -166,134 +192,347 @@ static void r(char * s) { if (m() > 0) setto(s); }
 
 */
 
-static void step1ab()
-{  if (b[k] == 's')
-   {  if (ends("\04" "sses")) k -= 2; else
-      if (ends("\03" "ies")) setto("\01" "i"); else
-      if (b[k-1] != 's') k--;
+static void step1ab(struct stemmer * z)
+{  char * b = z->b;
+   if (b[z->k] == 's')
+   {  if (ends(z, "\04" "sses")) z->k -= 2; else
+      if (ends(z, "\03" "ies")) setto(z, "\01" "i"); else
+      if (b[z->k-1] != 's') z->k--;
    }
-   if (ends("\03" "eed")) { if (m() > 0) k--; } else
-   if ((ends("\02" "ed") || ends("\03" "ing")) && vowelinstem())
-   {  k = j;
-      if (ends("\02" "at")) setto("\03" "ate"); else
-      if (ends("\02" "bl")) setto("\03" "ble"); else
-      if (ends("\02" "iz")) setto("\03" "ize"); else
-      if (doublec(k))
-      {  k--;
-         {  int ch = b[k];
-            if (ch == 'l' || ch == 's' || ch == 'z') k++;
+   if (ends(z, "\03" "eed")) { if (m(z) > 0) z->k--; } else
+   if ((ends(z, "\02" "ed") || ends(z, "\03" "ing")) && vowelinstem(z))
+   {  z->k = z->j;
+      if (ends(z, "\02" "at")) setto(z, "\03" "ate"); else
+      if (ends(z, "\02" "bl")) setto(z, "\03" "ble"); else
+      if (ends(z, "\02" "iz")) setto(z, "\03" "ize"); else
+      if (doublec(z, z->k))
+      {  z->k--;
+         {  int ch = b[z->k];
+            if (ch == 'l' || ch == 's' || ch == 'z') z->k++;
          }
       }
-      else if (m() == 1 && cvc(k)) setto("\01" "e");
+      else if (m(z) == 1 && cvc(z, z->k)) setto(z, "\01" "e");
    }
 }
 
-/* step1c() turns terminal y to i when there is another vowel in the stem. */
+/* step1c(z) turns terminal y to i when there is another vowel in the stem. */
 
-static void step1c() { if (ends("\01" "y") && vowelinstem()) b[k] = 'i'; }
+static void step1c(struct stemmer * z)
+{  if (ends(z, "\01" "y") && vowelinstem(z)) z->b[z->k] = 'i';
+}
 
 
-/* step2() maps double suffices to single ones. so -ization ( = -ize plus
+/* step2(z) maps double suffices to single ones. so -ization ( = -ize plus
    -ation) maps to -ize etc. note that the string before the suffix must give
-   m() > 0. */
+   m(z) > 0. 
+
+   Every suffix tested here is at least two letters long, so a stem that
+   step1ab() has already cut down to a single letter is left alone rather
+   than looking at b[k0-1]. */
 
-static void step2() { switch (b[k-1])
+static void step2(struct stemmer * z)
+{  if (z->k <= z->k0) return;
+   switch (z->b[z->k-1])
 {
-    case 'a': if (ends("\07" "ational")) { r("\03" "ate"); break; }
-              if (ends("\06" "tional")) { r("\04" "tion"); break; }
+    case 'a': if (ends(z, "\07" "ational")) { r(z, "\03" "ate"); break; }
+              if (ends(z, "\06" "tional")) { r(z, "\04" "tion"); break; }
               break;
-    case 'c': if (ends("\04" "enci")) { r("\04" "ence"); break; }
-              if (ends("\04" "anci")) { r("\04" "ance"); break; }
+    case 'c': if (ends(z, "\04" "enci")) { r(z, "\04" "ence"); break; }
+              if (ends(z, "\04" "anci")) { r(z, "\04" "ance"); break; }
               break;
-    case 'e': if (ends("\04" "izer")) { r("\03" "ize"); break; }
+    case 'e': if (ends(z, "\04" "izer")) { r(z, "\03" "ize"); break; }
               break;
-    case 'l': if (ends("\03" "bli")) { r("\03" "ble"); break; } /*-DEPARTURE-*/
+    case 'l': if (ends(z, "\03" "bli")) { r(z, "\03" "ble"); break; } /*-DEPARTURE-*/
 
  /* To match the published algorithm, replace this line with
-    case 'l': if (ends("\04" "abli")) { r("\04" "able"); break; } */
+    case 'l': if (ends(z, "\04" "abli")) { r(z, "\04" "able"); break; } */
 
-              if (ends("\04" "alli")) { r("\02" "al"); break; }
-              if (ends("\05" "entli")) { r("\03" "ent"); break; }
-              if (ends("\03" "eli")) { r("\01" "e"); break; }
-              if (ends("\05" "ousli")) { r("\03" "ous"); break; }
+              if (ends(z, "\04" "alli")) { r(z, "\02" "al"); break; }
+              if (ends(z, "\05" "entli")) { r(z, "\03" "ent"); break; }
+              if (ends(z, "\03" "eli")) { r(z, "\01" "e"); break; }
+              if (ends(z, "\05" "ousli")) { r(z, "\03" "ous"); break; }
               break;
-    case 'o': if (ends("\07" "ization")) { r("\03" "ize"); break; }
-              if (ends("\05" "ation")) { r("\03" "ate"); break; }
-              if (ends("\04" "ator")) { r("\03" "ate"); break; }
+    case 'o': if (ends(z, "\07" "ization")) { r(z, "\03" "ize"); break; }
+              if (ends(z, "\05" "ation")) { r(z, "\03" "ate"); break; }
+              if (ends(z, "\04" "ator")) { r(z, "\03" "ate"); break; }
               break;
-    case 's': if (ends("\05" "alism")) { r("\02" "al"); break; }
-              if (ends("\07" "iveness")) { r("\03" "ive"); break; }
-              if (ends("\07" "fulness")) { r("\03" "ful"); break; }
-              if (ends("\07" "ousness")) { r("\03" "ous"); break; }
+    case 's': if (ends(z, "\05" "alism")) { r(z, "\02" "al"); break; }
+              if (ends(z, "\07" "iveness")) { r(z, "\03" "ive"); break; }
+              if (ends(z, "\07" "fulness")) { r(z, "\03" "ful"); break; }
+              if (ends(z, "\07" "ousness")) { r(z, "\03" "ous"); break; }
               break;
-    case 't': if (ends("\05" "aliti")) { r("\02" "al"); break; }
-              if (ends("\05" "iviti")) { r("\03" "ive"); break; }
-              if (ends("\06" "biliti")) { r("\03" "ble"); break; }
+    case 't': if (ends(z, "\05" "aliti")) { r(z, "\02" "al"); break; }
+              if (ends(z, "\05" "iviti")) { r(z, "\03" "ive"); break; }
+              if (ends(z, "\06" "biliti")) { r(z, "\03" "ble"); break; }
               break;
-    case 'g': if (ends("\04" "logi")) { r("\03" "log"); break; } /*-DEPARTURE-*/
+    case 'g': if (ends(z, "\04" "logi")) { r(z, "\03" "log"); break; } /*-DEPARTURE-*/
 
  /* To match the published algorithm, delete this line */
 
 } }
 
-/* step3() deals with -ic-, -full, -ness etc. similar strategy to step2. */
+/* step3(z) deals with -ic-, -full, -ness etc. similar strategy to step2. */
 
-static void step3() { switch (b[k])
+static void step3(struct stemmer * z) { switch (z->b[z->k])
 {
-    case 'e': if (ends("\05" "icate")) { r("\02" "ic"); break; }
-              if (ends("\05" "ative")) { r("\00" ""); break; }
-              if (ends("\05" "alize")) { r("\02" "al"); break; }
+    case 'e': if (ends(z, "\05" "icate")) { r(z, "\02" "ic"); break; }
+              if (ends(z, "\05" "ative")) { r(z, "\00" ""); break; }
+              if (ends(z, "\05" "alize")) { r(z, "\02" "al"); break; }
               break;
-    case 'i': if (ends("\05" "iciti")) { r("\02" "ic"); break; }
+    case 'i': if (ends(z, "\05" "iciti")) { r(z, "\02" "ic"); break; }
               break;
-    case 'l': if (ends("\04" "ical")) { r("\02" "ic"); break; }
-              if (ends("\03" "ful")) { r("\00" ""); break; }
+    case 'l': if (ends(z, "\04" "ical")) { r(z, "\02" "ic"); break; }
+              if (ends(z, "\03" "ful")) { r(z, "\00" ""); break; }
               break;
-    case 's': if (ends("\04" "ness")) { r("\00" ""); break; }
+    case 's': if (ends(z, "\04" "ness")) { r(z, "\00" ""); break; }
               break;
 } }
 
-/* step4() takes off -ant, -ence etc., in context <c>vcvc<v>. */
-
-static void step4()
-{  switch (b[k-1])
-    {  case 'a': if (ends("\02" "al")) break; return;
-       case 'c': if (ends("\04" "ance")) break;
-                 if (ends("\04" "ence")) break; return;
-       case 'e': if (ends("\02" "er")) break; return;
-       case 'i': if (ends("\02" "ic")) break; return;
-       case 'l': if (ends("\04" "able")) break;
-                 if (ends("\04" "ible")) break; return;
-       case 'n': if (ends("\03" "ant")) break;
-                 if (ends("\05" "ement")) break;
-                 if (ends("\04" "ment")) break;
-                 if (ends("\03" "ent")) break; return;
-       case 'o': if (ends("\03" "ion") && (b[j] == 's' || b[j] == 't')) break;
-                 if (ends("\02" "ou")) break; return;
+/* step4(z) takes off -ant, -ence etc., in context <c>vcvc<v>.  As in
+   step2(), a single letter stem is left alone. */
+
+static void step4(struct stemmer * z)
+{  if (z->k <= z->k0) return;
+   switch (z->b[z->k-1])
+    {  case 'a': if (ends(z, "\02" "al")) break; return;
+       case 'c': if (ends(z, "\04" "ance")) break;
+                 if (ends(z, "\04" "ence")) break; return;
+       case 'e': if (ends(z, "\02" "er")) break; return;
+       case 'i': if (ends(z, "\02" "ic")) break; return;
+       case 'l': if (ends(z, "\04" "able")) break;
+                 if (ends(z, "\04" "ible")) break; return;
+       case 'n': if (ends(z, "\03" "ant")) break;
+                 if (ends(z, "\05" "ement")) break;
+                 if (ends(z, "\04" "ment")) break;
+                 if (ends(z, "\03" "ent")) break; return;
+       case 'o': if (ends(z, "\03" "ion") && (z->b[z->j] == 's' || z->b[z->j] == 't')) break;
+                 if (ends(z, "\02" "ou")) break; return;
                  /* takes care of -ous */
-       case 's': if (ends("\03" "ism")) break; return;
-       case 't': if (ends("\03" "ate")) break;
-                 if (ends("\03" "iti")) break; return;
-       case 'u': if (ends("\03" "ous")) break; return;
-       case 'v': if (ends("\03" "ive")) break; return;
-       case 'z': if (ends("\03" "ize")) break; return;
+       case 's': if (ends(z, "\03" "ism")) break; return;
+       case 't': if (ends(z, "\03" "ate")) break;
+                 if (ends(z, "\03" "iti")) break; return;
+       case 'u': if (ends(z, "\03" "ous")) break; return;
+       case 'v': if (ends(z, "\03" "ive")) break; return;
+       case 'z': if (ends(z, "\03" "ize")) break; return;
        default: return;
     }
-    if (m() > 1) k = j;
+    if (m(z) > 1) z->k = z->j;
+}
+
+/* step5(z) removes a final -e if m(z) > 1, and changes -ll to -l if
+   m(z) > 1. */
+
+static void step5(struct stemmer * z)
+{  char * b = z->b;
+   z->j = z->k;
+   if (b[z->k] == 'e')
+   {  int a = m(z);
+      if (a > 1 || (a == 1 && !cvc(z, z->k-1))) z->k--;
+   }
+   if (b[z->k] == 'l' && doublec(z, z->k) && m(z) > 1) z->k--;
+}
+
+/*--------------------table-driven suffix phase---------------------------*/
+
+/* Steps 2 to 5 again, the way stem() runs them. The cascades of ends()
+   above try each suffix in turn, and each r() works m() out from scratch
+   with cons() calls that recurse through any run of y's. Here the suffixes
+   of steps 2, 3 and 4 are held reversed in one trie, so that the right one
+   (if any) is found by a single backward scan of the word, and which
+   letters are consonants is worked out once into the bit mask z->c, from
+   which m() is a shift and a popcount.
+
+   In each step the suffixes that the cascade tests first are the longer
+   ones, and no two of them of different lengths end a word at once except
+   where the longer is tested first (-ational before -tional, -ization
+   before -ation, -ement before -ment before -ent), so the longest match in
+   the trie is the suffix the cascade would have found. That, and the
+   output, is checked against stem_reference() by bench/porter_bench.cpp.
+
+   The mask holds 64 letters, so longer words take the cascades. */
+
+struct rule {
+   const char * suffix;
+   const char * to;     /* what the suffix becomes */
+   int step;            /* 0, 1 or 2 for steps 2, 3 and 4 */
+};
+
+static const struct rule rules[] = {
+   /* step 2 */
+   { "ational", "ate", 0 }, { "tional", "tion", 0 }, { "enci", "ence", 0 },
+   { "anci", "ance", 0 }, { "izer", "ize", 0 }, { "bli", "ble", 0 },
+   { "alli", "al", 0 }, { "entli", "ent", 0 }, { "eli", "e", 0 },
+   { "ousli", "ous", 0 }, { "ization", "ize", 0 }, { "ation", "ate", 0 },
+   { "ator", "ate", 0 }, { "alism", "al", 0 }, { "iveness", "ive", 0 },
+   { "fulness", "ful", 0 }, { "ousness", "ous", 0 }, { "aliti", "al", 0 },
+   { "iviti", "ive", 0 }, { "biliti", "ble", 0 }, { "logi", "log", 0 },
+   /* step 3 */
+   { "icate", "ic", 1 }, { "ative", "", 1 }, { "alize", "al", 1 },
+   { "iciti", "ic", 1 }, { "ical", "ic", 1 }, { "ful", "", 1 },
+   { "ness", "", 1 },
+   /* step 4; -ion only after s or t, see suffix() */
+   { "al", "", 2 }, { "ance", "", 2 }, { "ence", "", 2 }, { "er", "", 2 },
+   { "ic", "", 2 }, { "able", "", 2 }, { "ible", "", 2 }, { "ant", "", 2 },
+   { "ement", "", 2 }, { "ment", "", 2 }, { "ent", "", 2 }, { "ion", "", 2 },
+   { "ou", "", 2 }, { "ism", "", 2 }, { "ate", "", 2 }, { "iti", "", 2 },
+   { "ous", "", 2 }, { "ive", "", 2 }, { "ize", "", 2 }
+};
+
+#define RULES (int) (sizeof(rules) / sizeof(rules[0]))
+#define NODES 256
+
+/* Node 0 is the root; next[n][ch] is the node after n on the letter
+   'a'+ch, or 0 if there is none, and rule[n][step] is the rule whose
+   reversed suffix ends at n, or -1. */
+
+struct trie {
+   unsigned char next[NODES][26];
+   signed char rule[NODES][3];
+   unsigned char length[RULES];  /* of each rule's to */
+   int ion;                      /* the rule for -ion */
+};
+
+static struct trie build_trie()
+{  struct trie t;
+   int nodes = 1;
+   memset(t.next, 0, sizeof(t.next));
+   memset(t.rule, -1, sizeof(t.rule));
+   for (int r = 0; r < RULES; r++)
+   {  const char * s = rules[r].suffix;
+      int node = 0;
+      for (int i = (int) strlen(s) - 1; i >= 0; i--)
+      {  int ch = s[i] - 'a';
+         if (t.next[node][ch] == 0) t.next[node][ch] = nodes++;
+         node = t.next[node][ch];
+      }
+      t.rule[node][rules[r].step] = r;
+      t.length[r] = strlen(rules[r].to);
+      if (strcmp(s, "ion") == 0) t.ion = r;
+   }
+   return t;
+}
+
+static const struct trie trie = build_trie();
+
+/* consonants(z, i) works out the bits of z->c from b[i] to b[k], and
+   clears the ones after k. y is a consonant at the start of the word or
+   after a vowel, as in cons(). */
+
+static void consonants(struct stemmer * z, int i)
+{  unsigned long long c = z->c;
+   int n = z->k - z->k0;
+   if (n < 63) c &= (2ULL << n) - 1;
+   for (; i <= z->k; i++)
+   {  unsigned long long bit = 1ULL << (i - z->k0);
+      int consonant;
+      switch (z->b[i])
+      {  case 'a': case 'e': case 'i': case 'o': case 'u': consonant = FALSE; break;
+         case 'y': consonant = i == z->k0 || !(c & (bit >> 1)); break;
+         default: consonant = TRUE;
+      }
+      c = consonant ? c | bit : c & ~bit;
+   }
+   z->c = c;
+}
+
+/* The mask is only worked out once something needs it, which most words
+   never do; z->masked is TRUE once it has been. */
+
+static void mask(struct stemmer * z)
+{  if (!z->masked) { z->c = 0; consonants(z, z->k0); z->masked = TRUE; }
+}
+
+/* cmask(z, i) is TRUE <=> b[i] is a consonant, from the mask. */
+
+#define cmask(z, i) (((z)->c >> ((i) - (z)->k0)) & 1)
+
+/* mmask(z) is m(z), from the mask: the number of consonants from k0+1 to j
+   that follow a vowel. */
+
+static int mmask(struct stemmer * z)
+{  int n = z->j - z->k0;
+   unsigned long long vc;
+   if (n < 1) return 0;
+   mask(z);
+   vc = z->c & ~(z->c << 1) & ~1ULL;
+   if (n < 63) vc &= (2ULL << n) - 1;
+   return __builtin_popcountll(vc);
+}
+
+static int doublecmask(struct stemmer * z, int j)
+{  if (j < z->k0+1) return FALSE;
+   if (z->b[j] != z->b[j-1] || !ascii(z, j)) return FALSE;
+   mask(z);
+   return cmask(z, j);
 }
 
-/* step5() removes a final -e if m() > 1, and changes -ll to -l if
-   m() > 1. */
+static int cvcmask(struct stemmer * z, int i)
+{  if (i < z->k0+2) return FALSE;
+   mask(z);
+   if (!cmask(z, i) || cmask(z, i-1) || !cmask(z, i-2)) return FALSE;
+   if (!ascii(z, i) || !ascii(z, i-2)) return FALSE;
+   {  int ch = z->b[i];
+      if (ch == 'w' || ch == 'x' || ch == 'y') return FALSE;
+   }
+   return TRUE;
+}
 
-static void step5()
-{  j = k;
-   if (b[k] == 'e')
-   {  int a = m();
-      if (a > 1 || a == 1 && !cvc(k-1)) k--;
+/* cut(z, k) sets the end of the word to k, with the mask, if there is one,
+   brought up to date from j+1. */
+
+static void cut(struct stemmer * z, int k)
+{  z->k = k;
+   if (z->masked) consonants(z, z->j+1);
+}
+
+/* suffix(z, step) is step2(z), step3(z) or step4(z) for step 0, 1 or 2. It
+   follows the end of the word back through the trie, remembering the
+   longest suffix of the step's that it passes, and then applies its rule if
+   m() of the rest is big enough. */
+
+static void suffix(struct stemmer * z, int step)
+{  const char * b = z->b;
+   int node = 0, found = -1, i;
+   for (i = z->k; i >= z->k0; i--)
+   {  unsigned int ch = (unsigned char) b[i] - 'a';
+      if (ch >= 26 || (node = trie.next[node][ch]) == 0) break;
+      if (trie.rule[node][step] >= 0) { found = trie.rule[node][step]; z->j = i-1; }
+   }
+   if (found < 0) return;
+
+   if (step < 2)
+   {  if (mmask(z) > 0)
+      {  memcpy(z->b+z->j+1, rules[found].to, trie.length[found]);
+         cut(z, z->j+trie.length[found]);
+      }
+      return;
    }
-   if (b[k] == 'l' && doublec(k) && m() > 1) k--;
+   /* the cascade looks at b[j] even when -ion is the whole word, but then
+      m() is 0 and nothing changes whatever it is */
+   if (found == trie.ion &&
+       !(z->j >= z->k0 && (b[z->j] == 's' || b[z->j] == 't'))) return;
+   if (mmask(z) > 1) cut(z, z->j);
 }
 
+/* step5mask(z) is step5(z) from the mask. Taking the e off changes nothing
+   before it, so m() is worked out at most once for both tests. */
+
+static void step5mask(struct stemmer * z)
+{  char * b = z->b;
+   int a = -1;
+   z->j = z->k;
+   if (b[z->k] == 'e')
+   {  a = mmask(z);
+      if (a > 1 || (a == 1 && !cvcmask(z, z->k-1))) z->k--;
+   }
+   if (b[z->k] == 'l' && doublecmask(z, z->k))
+   {  if (a < 0) a = mmask(z);
+      if (a > 1) z->k--;
+   }
+}
+
+/*--------------------------------------------------------------------------*/
+
 /* In stem(p,i,j), p is a char pointer, and the string to be stemmed is from
    p[i] to p[j] inclusive. Typically i is zero and j is the offset to the last
    character of a string, (p[j+1] == '\0'). The stemmer adjusts the
@@ -301,19 +540,39 @@ static void step5()
    Stemming never increases word length, so i <= k <= j. To turn the stemmer
    into a module, declare 'stem' as extern, and delete the remainder of this
    file.
+
+   stem() keeps all of its state on its own stack, so it is reentrant and
+   never allocates.
 */
 
 int stem(char * p, int i, int j)
-{  b = p; k = j; k0 = i; /* copy the parameters into statics */
-   if (k <= k0+1) return k; /*-DEPARTURE-*/
+{  struct stemmer z;
+   z.b = p; z.k = j; z.k0 = i; z.j = 0; z.masked = FALSE; /* copy the parameters into z */
+   if (z.k <= z.k0+1) return z.k; /*-DEPARTURE-*/
 
    /* With this line, strings of length 1 or 2 don't go through the
       stemming process, although no mention is made of this in the
       published algorithm. Remove the line to match the published
       algorithm. */
 
-   step1ab(); step1c(); step2(); step3(); step4(); step5();
-   return k;
+   step1ab(&z); step1c(&z);
+   if (z.k - z.k0 >= 64)
+   {  step2(&z); step3(&z); step4(&z); step5(&z);
+      return z.k;
+   }
+   suffix(&z, 0); suffix(&z, 1); suffix(&z, 2); step5mask(&z);
+   return z.k;
+}
+
+/* stem_reference(p,i,j) is stem(p,i,j) with the original cascades of
+   steps 2 to 5. */
+
+int stem_reference(char * p, int i, int j)
+{  struct stemmer z;
+   z.b = p; z.k = j; z.k0 = i; z.j = 0; z.masked = FALSE;
+   if (z.k <= z.k0+1) return z.k; /*-DEPARTURE-*/
+   step1ab(&z); step1c(&z); step2(&z); step3(&z); step4(&z); step5(&z);
+   return z.k;
 }
 
 /*--------------------stemmer definition ends here------------------------*/
@@ -335,7 +594,11 @@ void increase_s()
    }
 }
 
-#define LETTER(ch) (isupper(ch) || islower(ch))
+/* Bytes of UTF-8 characters beyond ASCII count as letters too, so that
+   non-ASCII words are passed to stem() whole rather than broken up at each
+   of them (stem() treats them as consonants).  tolower() leaves them alone. */
+
+#define LETTER(ch) (isupper(ch) || islower(ch) || (ch) >= 0x80)
 
 static void stemfile(FILE * f)
 {  while(TRUE)
@@ -0,0 +1,24 @@
+/* porter.h - interface to the Porter stemmer in porter.cpp.
+
+   In stem(p,i,j), p is a char pointer, and the string to be stemmed is from
+   p[i] to p[j] inclusive. Typically i is zero and j is the offset to the last
+   character of a string, (p[j+1] == '\0'). The stemmer adjusts the
+   characters p[i] ... p[j] and returns the new end-point of the string, k.
+   Stemming never increases word length, so i <= k <= j.
+
+   The letters must already be lower case.  stem() works in place on the
+   caller's buffer, never allocates, and is safe to call from several threads
+   at once.
+*/
+
+#ifndef PORTER_H
+#define PORTER_H
+
+extern int stem(char * p, int i, int j);
+
+/* The same, with steps 2 to 5 as the original cascades of suffix tests
+   rather than stem()'s table-driven ones, to check stem() against. */
+
+extern int stem_reference(char * p, int i, int j);
+
+#endif
@@ -0,0 +1,485 @@
+///////////////////////////////////////////////////////////////////////////////
+// records.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of splitting standard input into documents.  See records.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "records.h"
+#include "unicode.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+using namespace std;
+
+static const size_t INITIAL_BUFFER = 1 << 20;
+
+bool ParseRecordFormat(const char* name, RecordFormat& format)
+{
+	if (strcmp(name, "whole") == 0)
+		format = RECORDS_WHOLE;
+	else if (strcmp(name, "lines") == 0)
+		format = RECORDS_LINES;
+	else if (strcmp(name, "delimited") == 0)
+		format = RECORDS_DELIMITED;
+	else if (strcmp(name, "length") == 0)
+		format = RECORDS_LENGTH;
+	else if (strcmp(name, "jsonl") == 0)
+		format = RECORDS_JSONL;
+	else
+		return false;
+	return true;
+}
+
+RecordReader::RecordReader(RecordFormat format, const string& delimiter)
+{
+	m_format = format;
+	m_delimiter = delimiter;
+	m_fd = -1;
+	m_eof = true;
+	m_pos = m_end = 0;
+	m_count = 0;
+}
+
+void RecordReader::Open(int fd)
+{
+	m_fd = fd;
+	m_eof = false;
+	if (m_buffer.size() < INITIAL_BUFFER)
+		m_buffer.resize(INITIAL_BUFFER);
+	m_pos = m_end = 0;
+	m_count = 0;
+	m_names.clear();
+	m_error.clear();
+}
+
+// Reads more input after what is already buffered, moving that to the front
+// of the buffer (so views into it are no longer valid) and growing the
+// buffer if it is full.  Returns false at the end of the input.
+bool RecordReader::Fill()
+{
+	if (m_eof)
+		return false;
+
+	char* data = m_buffer.data();
+	if (m_pos > 0)
+	{
+		memmove(data, data + m_pos, m_end - m_pos);
+		m_end -= m_pos;
+		m_pos = 0;
+	}
+	if (m_end == m_buffer.size())
+	{
+		m_buffer.resize(m_buffer.size() * 2);
+		data = m_buffer.data();
+	}
+
+	ssize_t got;
+	do
+	{
+		got = read(m_fd, data + m_end, m_buffer.size() - m_end);
+	} while (got < 0 && errno == EINTR);
+
+	if (got <= 0)
+	{
+		if (got < 0)
+			m_error = "can't be read";
+		m_eof = true;
+		return false;
+	}
+	m_end += got;
+	return true;
+}
+
+bool RecordReader::Fail(const char* error)
+{
+	m_error = error;
+	m_pos = m_end;
+	m_eof = true;
+	return false;
+}
+
+// Sets line to the next line, without its "\n" (or "\r\n").  The last line
+// needn't end in one.  Returns false at the end of the input.
+bool RecordReader::Line(string_view& line)
+{
+	size_t scanned = 0;
+	while (true)
+	{
+		const char* data = m_buffer.data() + m_pos;
+		size_t available = m_end - m_pos;
+		const char* newline = (const char*) memchr(data + scanned, '\n',
+			available - scanned);
+		size_t length;
+		if (newline != NULL)
+		{
+			length = newline - data;
+			m_pos += length + 1;
+		}
+		else if (Fill())
+		{
+			scanned = available;
+			continue;
+		}
+		else if (available > 0)
+		{
+			length = available;
+			m_pos = m_end;
+		}
+		else
+		{
+			return false;
+		}
+
+		if (length > 0 && data[length - 1] == '\r')
+			length--;
+		line = string_view(data, length);
+		return true;
+	}
+}
+
+// Whether name can be used as it is in the output file's name and on a line
+// of the .edmf: it mustn't reach into another directory, or hold a newline,
+// tab or other control character.
+static bool PlainName(const string& name)
+{
+	if (name.compare(0, 2, "..") == 0)
+		return false;
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		unsigned char c = (unsigned char) name[i];
+		if (c == '/' || c < 0x20 || c == 0x7f)
+			return false;
+	}
+	return true;
+}
+
+bool RecordReader::Next(string_view& name, string_view& text)
+{
+	m_name.clear();
+	bool read;
+	switch (m_format)
+	{
+	case RECORDS_LINES:
+		read = Line(text);
+		break;
+	case RECORDS_LENGTH:
+		read = NextLength(text);
+		break;
+	case RECORDS_JSONL:
+		read = NextJson(text);
+		break;
+	default:
+		read = NextDelimited(text);
+		break;
+	}
+	if (!read)
+		return false;
+
+	if (!PlainName(m_name))
+		return Fail("has a record name that isn't a plain file name");
+	m_count++;
+	if (m_name.empty())
+		m_name = "STDIN." + to_string(m_count);
+	// a second document of the same name would overwrite the first's file
+	if (!m_names.insert(m_name).second)
+		return Fail(("has two records named " + m_name).c_str());
+	name = m_name;
+	return true;
+}
+
+// Reads up to the next delimiter line, which isn't part of the document.
+// Whatever follows the last delimiter is a document too, unless it's empty.
+bool RecordReader::NextDelimited(string_view& text)
+{
+	size_t scanned = 0;		// where the next line starts, from m_pos
+	while (true)
+	{
+		const char* data = m_buffer.data() + m_pos;
+		size_t available = m_end - m_pos;
+		const char* newline = (const char*) memchr(data + scanned, '\n',
+			available - scanned);
+		if (newline == NULL && Fill())
+			continue;
+
+		size_t lineEnd = newline != NULL ? newline - data : available;
+		if (newline == NULL && scanned == available)
+		{
+			// the input ends after a whole line
+			if (available == 0)
+				return false;
+			text = string_view(data, available);
+			m_pos = m_end;
+			return true;
+		}
+
+		string_view line(data + scanned, lineEnd - scanned);
+		if (line.size() > 0 && line.back() == '\r')
+			line.remove_suffix(1);
+		if (line == m_delimiter)
+		{
+			text = string_view(data, scanned);
+			m_pos += newline != NULL ? lineEnd + 1 : lineEnd;
+			return true;
+		}
+		scanned = newline != NULL ? lineEnd + 1 : available;
+	}
+}
+
+// Reads a "<bytes> [name]" line (skipping blank lines before it, so that
+// documents may be followed by a newline) and then the document.
+bool RecordReader::NextLength(string_view& text)
+{
+	string_view line;
+	do
+	{
+		if (!Line(line))
+			return false;
+	} while (line.empty());
+
+	size_t length = 0;
+	size_t i = 0;
+	for (; i < line.size() && line[i] >= '0' && line[i] <= '9'; i++)
+	{
+		if (length > ((size_t) -1 - 9) / 10)
+			return Fail("has a record too long to read");
+		length = length * 10 + (line[i] - '0');
+	}
+	if (i == 0 || (i < line.size() && line[i] != ' '))
+		return Fail("has a malformed record length");
+	if (i < line.size())
+		m_name.assign(line.substr(i + 1));
+
+	while (m_end - m_pos < length)
+	{
+		if (!Fill())
+			return Fail("ends in the middle of a record");
+	}
+	text = string_view(m_buffer.data() + m_pos, length);
+	m_pos += length;
+	return true;
+}
+
+static void SkipSpace(const char*& p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+		p++;
+}
+
+static int HexDigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Reads the four hex digits of a \u escape at p.
+static bool ReadHex(const char*& p, const char* end, unsigned int& code)
+{
+	if (end - p < 4)
+		return false;
+	code = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		int digit = HexDigit(*p++);
+		if (digit < 0)
+			return false;
+		code = code * 16 + digit;
+	}
+	return true;
+}
+
+// Reads the JSON string at p, unescaped, into out.
+static bool ReadString(const char*& p, const char* end, string& out)
+{
+	out.clear();
+	if (p == end || *p != '"')
+		return false;
+	p++;
+	while (p < end)
+	{
+		const char* run = p;
+		while (p < end && *p != '"' && *p != '\\')
+			p++;
+		out.append(run, p - run);
+		if (p == end)
+			return false;
+		if (*p++ == '"')
+			return true;
+
+		if (p == end)
+			return false;
+		char c = *p++;
+		switch (c)
+		{
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u':
+		{
+			unsigned int code;
+			if (!ReadHex(p, end, code))
+				return false;
+			// a surrogate pair makes up one character past U+FFFF, and a
+			// surrogate on its own is no character at all
+			unsigned int low;
+			if (code >= 0xd800 && code < 0xdc00 && end - p >= 6 &&
+				p[0] == '\\' && p[1] == 'u')
+			{
+				const char* q = p + 2;
+				if (ReadHex(q, end, low) && low >= 0xdc00 && low < 0xe000)
+				{
+					code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					p = q;
+				}
+			}
+			if (code >= 0xd800 && code < 0xe000)
+				code = 0xfffd;
+			char utf8[4];
+			out.append(utf8, EncodeUtf8(code, utf8));
+			break;
+		}
+		default:
+			// \" \\ \/, and anything else stands for itself
+			out += c;
+			break;
+		}
+	}
+	return false;
+}
+
+// Skips the JSON value at p, whatever it is.
+static bool SkipValue(const char*& p, const char* end, string& scratch)
+{
+	if (p == end)
+		return false;
+	if (*p == '"')
+		return ReadString(p, end, scratch);
+
+	if (*p == '{' || *p == '[')
+	{
+		int depth = 0;
+		while (p < end)
+		{
+			if (*p == '"')
+			{
+				if (!ReadString(p, end, scratch))
+					return false;
+				continue;
+			}
+			if (*p == '{' || *p == '[')
+				depth++;
+			else if (*p == '}' || *p == ']')
+			{
+				if (--depth == 0)
+				{
+					p++;
+					return true;
+				}
+			}
+			p++;
+		}
+		return false;
+	}
+
+	// a number, true, false or null
+	const char* start = p;
+	while (p < end && strchr(",}] \t\r\n", *p) == NULL)
+		p++;
+	return p > start;
+}
+
+// Reads the next non-blank line as a JSON object.
+bool RecordReader::NextJson(string_view& text)
+{
+	string_view line;
+	const char* p;
+	const char* end;
+	do
+	{
+		if (!Line(line))
+			return false;
+		p = line.data();
+		end = p + line.size();
+		SkipSpace(p, end);
+	} while (p == end);
+
+	static const char* malformed = "has a line that isn't a JSON object";
+	if (*p++ != '{')
+		return Fail(malformed);
+
+	bool hasText = false;
+	bool hasName = false;
+	string key, scratch;
+	SkipSpace(p, end);
+	if (p < end && *p == '}')
+		p++;
+	else while (true)
+	{
+		SkipSpace(p, end);
+		if (!ReadString(p, end, key))
+			return Fail(malformed);
+		SkipSpace(p, end);
+		if (p == end || *p++ != ':')
+			return Fail(malformed);
+		SkipSpace(p, end);
+
+		bool ok;
+		if (key == "text")
+		{
+			ok = ReadString(p, end, m_text);
+			hasText = true;
+		}
+		else if ((key == "name" || (key == "id" && !hasName)) && p < end &&
+			*p == '"')
+		{
+			ok = ReadString(p, end, m_name);
+			hasName = key == "name";
+		}
+		else if (key == "id" && !hasName)
+		{
+			// a numeric id
+			const char* start = p;
+			if (p < end && *p != '-' && (*p < '0' || *p > '9'))
+			{
+				return Fail("has a JSON \"id\" that isn't a string or a "
+					"number");
+			}
+			ok = SkipValue(p, end, scratch);
+			m_name.assign(start, p - start);
+		}
+		else
+		{
+			ok = SkipValue(p, end, scratch);
+		}
+		if (!ok)
+			return Fail(malformed);
+
+		SkipSpace(p, end);
+		if (p < end && *p == ',')
+		{
+			p++;
+			continue;
+		}
+		if (p < end && *p == '}')
+		{
+			p++;
+			break;
+		}
+		return Fail(malformed);
+	}
+
+	SkipSpace(p, end);
+	if (p != end)
+		return Fail(malformed);
+	if (!hasText)
+		return Fail("has a JSON object without a \"text\" string");
+
+	text = m_text;
+	return true;
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// records.h
+///////////////////////////////////////////////////////////////////////////////
+// Splitting standard input into documents (--records), so that a producer
+// can pipe any number of documents straight in instead of writing each one
+// to a file first.
+//
+// The formats are:
+//     lines       every line is a document
+//     delimited   documents are separated by lines that are exactly the
+//                 delimiter (--delimiter, "^^^^^^^^" by default)
+//     length      each document is a line "<bytes>" or "<bytes> <name>",
+//                 followed by exactly that many bytes of text
+//     jsonl       every line is a JSON object, whose "text" string is the
+//                 document and whose "name" (or "id") names it
+//
+// Documents without a name of their own are named STDIN.1, STDIN.2, ... in
+// the order they are read.  A name is used as part of a file name, so one
+// that holds a "/" or a control character or starts with "..", or that an
+// earlier document already had, is an error.  Only one document is held in
+// memory at a time, along with the names of those before it.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+enum RecordFormat
+{
+	RECORDS_WHOLE,		// all of standard input is one document
+	RECORDS_LINES,
+	RECORDS_DELIMITED,
+	RECORDS_LENGTH,
+	RECORDS_JSONL
+};
+
+// Reads "whole", "lines", "delimited", "length" or "jsonl".  Returns false if
+// name isn't one of those.
+bool ParseRecordFormat(const char* name, RecordFormat& format);
+
+class RecordReader
+{
+public:
+	RecordReader(RecordFormat format, const std::string& delimiter);
+
+	// Starts reading an already open descriptor, which isn't closed.
+	void Open(int fd);
+
+	// Sets name and text to the next document's.  They are only valid until
+	// the next call.  Returns false at the end of the input, or if it is
+	// malformed, in which case Error() says how.
+	bool Next(std::string_view& name, std::string_view& text);
+
+	// What was wrong with the input, or "" if nothing.
+	const std::string& Error() const { return m_error; }
+
+private:
+	bool Line(std::string_view& line);
+	bool Fill();
+	bool Fail(const char* error);
+	bool NextDelimited(std::string_view& text);
+	bool NextLength(std::string_view& text);
+	bool NextJson(std::string_view& text);
+
+	RecordFormat m_format;
+	std::string m_delimiter;
+	int m_fd;
+	bool m_eof;
+
+	// the input read so far and not yet handed out is [m_pos, m_end) of
+	// m_buffer
+	std::vector<char> m_buffer;
+	size_t m_pos;
+	size_t m_end;
+
+	unsigned long long m_count;	// documents read
+	std::string m_name;
+	std::unordered_set<std::string> m_names;	// every one handed out
+	std::string m_text;			// unescaped JSON text
+	std::string m_error;
+};
+
+#endif
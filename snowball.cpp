@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// snowball.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of SnowballWord.  See snowball.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "snowball.h"
+#include "unicode.h"
+
+#include <string.h>
+using namespace std;
+
+static int Length(const char32_t* text)
+{
+	int length = 0;
+	while (text[length] != 0)
+		length++;
+	return length;
+}
+
+bool SnowballWord::Load(const char* text, size_t length)
+{
+	m_size = 0;
+	while (length > 0)
+	{
+		if (m_size == MAX_LENGTH)
+			return false;
+
+		size_t bytes = DecodeUtf8(text, length, m_chars[m_size]);
+		if (bytes == 0)
+			return false;
+		m_size++;
+		text += bytes;
+		length -= bytes;
+	}
+	return true;
+}
+
+size_t SnowballWord::Store(char* text, size_t length) const
+{
+	char out[4 * sizeof(m_chars) / sizeof(m_chars[0])];
+	size_t bytes = 0;
+	for (int i = 0; i < m_size; i++)
+		bytes += EncodeUtf8(m_chars[i], out + bytes);
+	if (bytes > length)
+		return length;
+	memcpy(text, out, bytes);
+	return bytes;
+}
+
+bool SnowballWord::Equals(const char32_t* word) const
+{
+	return Length(word) == m_size && StartsWith(word);
+}
+
+bool SnowballWord::StartsWith(const char32_t* prefix) const
+{
+	int i = 0;
+	for (; prefix[i] != 0; i++)
+	{
+		if (i == m_size || m_chars[i] != prefix[i])
+			return false;
+	}
+	return true;
+}
+
+bool SnowballWord::EndsWith(const char32_t* suffix) const
+{
+	int length = Length(suffix);
+	if (length > m_size)
+		return false;
+	for (int i = 0; i < length; i++)
+	{
+		if (m_chars[m_size - length + i] != suffix[i])
+			return false;
+	}
+	return true;
+}
+
+bool SnowballWord::Replace(int start, int end, const char32_t* text)
+{
+	int length = Length(text);
+	int size = m_size - (end - start) + length;
+	if (size > (int) (sizeof(m_chars) / sizeof(m_chars[0])))
+		return false;
+
+	memmove(m_chars + start + length, m_chars + end,
+		(m_size - end) * sizeof(char32_t));
+	memcpy(m_chars + start, text, length * sizeof(char32_t));
+	m_size = size;
+	return true;
+}
+
+int SnowballWord::Longest(const Suffix* suffixes, int count, int limit,
+						  int& start) const
+{
+	if (m_size == 0)
+		return -1;
+
+	// most words end with a letter that no suffix does
+	char32_t last = m_chars[m_size - 1];
+	int rule = -1, longest = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const char32_t* text = suffixes[i].text;
+		int length = Length(text);
+		if (text[length - 1] != last || length <= longest ||
+			m_size - length < limit || !EndsWith(text))
+			continue;
+		rule = suffixes[i].rule;
+		longest = length;
+	}
+	start = m_size - longest;
+	return rule;
+}
+
+int SnowballWord::AfterVowelConsonant(int start, bool (*isVowel)(char32_t))
+	const
+{
+	int i = start;
+	while (i < m_size && !isVowel(m_chars[i]))
+		i++;
+	while (i < m_size && isVowel(m_chars[i]))
+		i++;
+	return i < m_size ? i + 1 : m_size;
+}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// snowball.h
+///////////////////////////////////////////////////////////////////////////////
+// What the Snowball stemmers (english.cpp, german.cpp and french.cpp) have
+// in common.
+//
+// The Snowball algorithms are defined on characters rather than bytes, so a
+// word is decoded from UTF-8 into a SnowballWord, a fixed array of code
+// points on the stack, stemmed there, and encoded back over the original.
+// Nothing is allocated.  The algorithms only ever look at and change the end
+// of a word, apart from a pass over the whole word to mark some letters
+// before and after, so a SnowballWord is little more than a suffix matcher.
+//
+// The regions the algorithms talk about are positions in the word: R1 starts
+// after the first non-vowel that follows a vowel, R2 is R1 worked out again
+// from there, and a suffix is "in R1" if it starts at or after it.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef SNOWBALL_H
+#define SNOWBALL_H
+
+#include <stddef.h>
+
+class Stemmer;
+
+// A suffix a step looks for, and the rule of the step's that applies when it
+// is the longest one the word ends with.
+struct Suffix
+{
+	const char32_t* text;
+	int rule;
+};
+
+class SnowballWord
+{
+public:
+	// The longest word, in characters, that is stemmed.
+	static const int MAX_LENGTH = 64;
+
+	// Decodes text[0..length).  Returns false if it is longer than
+	// MAX_LENGTH or isn't valid UTF-8.
+	bool Load(const char* text, size_t length);
+
+	// Encodes the word over text and returns its length in bytes, unless
+	// that would be more than length, in which case text is left alone and
+	// length is returned.
+	size_t Store(char* text, size_t length) const;
+
+	int Size() const { return m_size; }
+	char32_t operator[](int i) const { return m_chars[i]; }
+	void Set(int i, char32_t c) { m_chars[i] = c; }
+
+	bool Equals(const char32_t* word) const;
+	bool StartsWith(const char32_t* prefix) const;
+	bool EndsWith(const char32_t* suffix) const;
+
+	// Replaces the characters from start to end with text.  Returns false,
+	// changing nothing, if the word would be too long.
+	bool Replace(int start, int end, const char32_t* text);
+
+	// Replaces the end of the word, from start on, with text.
+	bool SetEnd(int start, const char32_t* text)
+		{ return Replace(start, m_size, text); }
+
+	void Truncate(int size) { m_size = size; }
+
+	// Finds the longest of suffixes[0..count) that the word ends with and
+	// that starts at or after limit.  Returns its rule, setting start to
+	// where it starts, or -1 if there isn't one.
+	int Longest(const Suffix* suffixes, int count, int limit, int& start)
+		const;
+
+	// The position after the first non-vowel that follows a vowel, from
+	// start on, or Size() if there isn't one.  isVowel says what a vowel is.
+	int AfterVowelConsonant(int start, bool (*isVowel)(char32_t)) const;
+
+private:
+	// room for a German word to grow when each sharp s becomes "ss"
+	char32_t m_chars[2 * MAX_LENGTH];
+	int m_size;
+};
+
+// Whether c is one of the characters of set.
+inline bool OneOf(const char32_t* set, char32_t c)
+{
+	for (; *set != 0; set++)
+	{
+		if (*set == c)
+			return true;
+	}
+	return false;
+}
+
+// The number of elements of an array of Suffixes.
+#define SUFFIXES(array) ((int) (sizeof(array) / sizeof((array)[0])))
+
+const Stemmer& EnglishStemmer();
+const Stemmer& GermanStemmer();
+const Stemmer& FrenchStemmer();
+
+#endif
@@ -13,10 +13,12 @@
 // it is likely that it does not contain most words in the universe of input 
 // files (most input will likely be of the "*.txt" form).
 //
-// The program uses a map of maps to generate this information on a single
-// pass through the data.  The first entry in the map is a string representing 
-// the actual word, and the second information is a map to all filenames using
-// that word, and the count for how many times that word occurs in the file.
+// The program generates this information on a single pass through the data.
+// Each word is interned once into a term dictionary that maps it to a dense
+// term id, each input file gets a dense document id, and the count for how
+// many times a word occurs in a file is kept in that file's sparse vector of
+// (term id, count) pairs (see termdict.h).  Dimensions are assigned at output
+// time, in alphabetical order of the words.
 //
 // Author: Ben Anderson
 // Date: May 05, 2005
@@ -27,155 +29,179 @@
 #include <fstream>
 #include <string>
 #include <string.h>
-#include <map>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <vector>
+#include <deque>
 #include <set>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "termdict.h"
+#include "stemmer.h"
+#include "stemcache.h"
+#include "tokenizer.h"
+#include "normalize.h"
+#include "stopwords.h"
+#include "writer.h"
+#include "csr.h"
+#include "spill.h"
+#include "docfreq.h"
+#include "weight.h"
+#include "ngram.h"
+#include "hashdims.h"
+#include "records.h"
+#include "inputs.h"
+#include "stats.h"
 using namespace std;
 
+// Threads that open and read ahead the files about to be processed.
+const unsigned int PREFETCH_THREADS = 2;
+
 // This is a pretty simple program so it's ok to use globals.
-// map<word, map<filename, count for word in filename> > 
-map<string, map<string, int> > g_words;
+// word <-> term id
+TermDictionary g_dictionary;
+// filename <-> document id, and the (term id, count) pairs for each document
+DocumentTable g_documents;
+// The words --stop-words removes.
+StopList g_stopList;
+// How many documents each term of g_dictionary occurs in, when needed.
+DocumentFrequencies g_frequencies;
+// With --hash-dims, how words are hashed to dimensions, in place of 
+// g_dictionary.
+FeatureHasher* g_hasher = NULL;
+// When streaming with a --dictionary, words it doesn't have are left out 
+// rather than added, since the dimension mapping has already been written.
+bool g_fixedDictionary = false;
+// Where g_documents spills its sparse vectors under --memory-limit.
+SpillFile g_spill;
+// Serializes the progress messages of the ingestion threads.
+mutex g_coutLock;
+// Totals over every thread's stem cache, reported at the end of the run.
+size_t g_stemCacheHits = 0;
+size_t g_stemCacheMisses = 0;
+// Totals over every thread's --stats counters, and what was written.
+StageStats g_stats;
+mutex g_statsLock;
+unsigned int g_threads = 1;
+size_t g_dimensions = 0;
+unsigned long long g_nonZeros = 0;
+unsigned long long g_bytesWritten = 0;
+
+enum OutputFormat
+{
+	FORMAT_TEXT,	// .edsf, or .edmf and .spasms files
+	FORMAT_CSR		// a binary .csr file (see csr.h)
+};
 
 class Arguments
 {
 public:
 	bool singleFile;
 	bool stem;
+	const Stemmer* stemmer;		// what stem uses
+	bool detectLanguage;		// or pick one for each document's language
 	bool stopWords;
 	string outFile;
+	string stopList;
+	int threads;
+	size_t stemCache;
+	PunctuationPolicy punctuation;
+	bool keepDigits;
+	unsigned int writeThreads;
+	OutputFormat format;
+	string fromCsr;
+	string dictionary;
+	size_t memoryLimit;
+	FrequencyLimit minDf;
+	FrequencyLimit maxDf;
+	size_t maxFeatures;
+	bool approximateDf;
+	Weighting weighting;
+	int ngramMin;
+	int ngramMax;
+	unsigned int hashBits;		// 0 unless --hash-dims
+	uint32_t hashSeed;
+	RecordFormat records;		// how standard input is split into documents
+	string delimiter;
+	bool stream;
+	size_t prefetch;			// files to read ahead, 0 for none
+	bool quiet;
+	string stats;				// "" for none, "-" for standard output
 	
 	Arguments(bool singleFile, bool stem, bool stopWords, string outFile) { 
 		this->singleFile = singleFile; 
 		this->stem = stem;
+		this->stemmer = FindStemmer("porter");
+		this->detectLanguage = false;
 		this->stopWords = stopWords;
 		this->outFile = outFile;
+		this->threads = 1;
+		this->stemCache = 65536;
+		this->punctuation = PUNCT_DROP;
+		this->keepDigits = false;
+		this->writeThreads = 0;
+		this->format = FORMAT_TEXT;
+		this->memoryLimit = 0;
+		this->minDf = FrequencyLimit(0, false);
+		this->maxDf = FrequencyLimit(1.0, true);
+		this->maxFeatures = 0;
+		this->approximateDf = false;
+		this->weighting = WEIGHT_COUNT;
+		this->ngramMin = 1;
+		this->ngramMax = 1;
+		this->hashBits = 0;
+		this->hashSeed = 0;
+		this->records = RECORDS_WHOLE;
+		this->delimiter = "^^^^^^^^";
+		this->stream = false;
+		this->prefetch = 16;
+		this->quiet = false;
 	};
-};
 
-/* In stem(p,i,j), p is a char pointer, and the string to be stemmed is from
-   p[i] to p[j] inclusive. Typically i is zero and j is the offset to the last
-   character of a string, (p[j+1] == '\0'). The stemmer adjusts the
-   characters p[i] ... p[j] and returns the new end-point of the string, k.
-   Stemming never increases word length, so i <= k <= j. To turn the stemmer
-   into a module, declare 'stem' as extern, and delete the remainder of this
-   file.
-*/
+	// Whether anything but single words is counted.
+	bool Ngrams() const { return ngramMax > 1; }
+
+	// Whether the vocabulary is pruned by document frequency.
+	bool Prune() const
+	{
+		return minDf.value > 0 || maxDf.fraction == false || maxDf.value < 1 ||
+			maxFeatures > 0;
+	}
+};
 
-extern int stem(char* p, int i, int j);
 void PrintSyntax();
 void PrintDebug();
-void ProcessStream(istream& in, const string& out, const Arguments& args);
-void ToLower(string& str);
-void RemovePunct(string& str);
-bool IsStopWord(const string& str);
+unsigned int ProcessStream(Tokenizer& in, const string& name, 
+	const Arguments& args, TermDictionary& dictionary, 
+	DocumentTable& documents, StemCache* cache, NgramCounter* ngrams);
+void ProcessFiles(const vector<string>& filenames, const Arguments& args);
+bool WriteOutput(const Arguments& args);
+bool ProcessStandardInput(const Arguments& args);
 
-void ToLower(string& str)
+// Reads a size in bytes, optionally followed by K, M or G (for KB, MB or GB).
+bool ParseSize(const char* value, size_t& size)
 {
-	for (size_t i = 0; i < str.length(); i++)
-    {
-      str[i] = tolower(str[i]);
-    }
-}
+	char* end;
+	long long number = strtoll(value, &end, 10);
+	if (end == value || number < 0)
+		return false;
 
-void RemovePunct(string& str)
-{
-	for (size_t i = 0; i < str.length(); i++)
+	int shift = 0;
+	switch (*end)
 	{
-		if (!isalpha(str[i]))
-			str.erase(i,10);
+	case 'k': case 'K': shift = 10; end++; break;
+	case 'm': case 'M': shift = 20; end++; break;
+	case 'g': case 'G': shift = 30; end++; break;
 	}
-}
-
-void CallStemmer(string& str)
-{
-	ToLower(str);
-	RemovePunct(str);
-	
-	if (str.size() == 0)
-		return;
-	
-	char* s = new char[str.size()+1];
-	
-	strcpy(s, str.c_str());
-	s[stem(s,0,str.size()-1)+1] = 0;
-	str = s;
-	delete [] s;
-}
-
-bool IsStopWord(const string& str)
-{
-	if (str == "the")
-		return true;
-	else if (str == "a")
-		return true;
-	else if (str == "and")
-		return true;
-	else if (str == "or")
-		return true;
-	else if (str == "then")
-		return true;
-	else if (str == "that")
-		return true;
-	else if (str == "of")
-		return true;
-	else if (str == "for")
-		return true;
-	else if (str == "by")
-		return true;
-	else if (str == "as")
-		return true;
-	else if (str == "be")
-		return true;
-	else if (str == "this")
-		return true;
-	else if (str == "we")
-		return true;
-	else if (str == "which")
-		return true;
-	else if (str == "with")
-		return true;
-	else if (str == "at")
-		return true;
-	else if (str == "from")
-		return true;
-	else if (str == "such")
-		return true;
-	else if (str == "there")
-		return true;
-	else if (str == "if")
-		return true;
-	else if (str == "is")
-		return true;
-	else if (str == "it")
-		return true;
-	else if (str == "to")
-		return true;
-	else if (str == "but")
-		return true;
-	else if (str == "those")
-		return true;
-	else if (str == "their")
-		return true;
-	else if (str == "theirs")
-		return true;
-	else if (str == "them")
-		return true;
-	else if (str == "they")
-		return true;
-	else if (str == "too")
-		return true;
-	else if (str == "was")
-		return true;
-	else if (str == "were")
-		return true;
-	else if (str == "who")
-		return true;
-	else if (str == "whose")
-		return true;
-	else
+	if (*end != '\0')
 		return false;
-}
 
+	size = (size_t) number << shift;
+	return true;
+}
 
 // Print out how to use this program from the command line
 void PrintSyntax()
@@ -186,14 +212,125 @@ void PrintSyntax()
 		<< "data points in enchilada data format.  Each dimension corresponds to\n"
 		<< "a different word.  The words are listed in the description of the \n"  
 		<< "collection.  A new set of dimensions is calculated each time you run\n"
-		<< "spasmifytext based upon the words in the input files."
+		<< "spasmifytext based upon the words in the input files, unless\n"
+		<< "--dictionary is used to keep them from one run to the next.  With\n"
+		<< "no FILE, standard input is read."
 		<< endl << endl
 		<< "  -s, --single-file           output to single-file format\n" 
 		<< "  --output-file=FILENAME      the name of the datafile to output to.\n"
 		<< "                                if no file is specified, output\n"
 		<< "                                will be sent to a.edmf/edsf\n"
+		<< "  --format=FORMAT             text (the default) writes .edsf, or\n"
+		<< "                                .edmf and .spasms files.  csr writes\n"
+		<< "                                one binary .csr file (default a.csr)\n"
+		<< "                                holding the dimensions and a sparse\n"
+		<< "                                matrix of the counts.\n"
+		<< "  --dictionary=FILE           keep the dimensions in FILE: words it\n"
+		<< "                                lists keep their dimensions, and new\n"
+		<< "                                words get new dimensions after them\n"
+		<< "                                and are added to FILE (which is\n"
+		<< "                                created if it doesn't exist), so\n"
+		<< "                                earlier output stays valid\n"
+		<< "  --min-df=N, --max-df=N      leave out the words that occur in fewer\n"
+		<< "                                or more than N documents.  N may be\n"
+		<< "                                a fraction of them, such as 0.5\n"
+		<< "  --max-features=N            keep only the N words that occur in\n"
+		<< "                                the most documents\n"
+		<< "  --approximate-df            pick the --max-features words with a\n"
+		<< "                                fixed amount of memory, counting\n"
+		<< "                                only likely candidates\n"
+		<< "  --ngrams=N or M..N          count runs of M to N (at most 3)\n"
+		<< "                                consecutive words, such as \"new\n"
+		<< "                                york\", as well as single words.\n"
+		<< "                                --ngrams=2 counts only pairs.\n"
+		<< "  --hash-dims=N               hash words (and n-grams) to N\n"
+		<< "                                dimensions, a power of two such as\n"
+		<< "                                2^20, with no dictionary.  The\n"
+		<< "                                dimensions have no words\n"
+		<< "  --hash-seed=N               seed the hashing with N (default 0)\n"
+		<< "  --weight=WEIGHTING          what to write for each word:\n"
+		<< "                                count  how many times it occurs\n"
+		<< "                                       (the default)\n"
+		<< "                                tf     count / words in document\n"
+		<< "                                tfidf  count * inverse document\n"
+		<< "                                       frequency\n"
+		<< "                                bm25   Okapi BM25\n"
+		<< "                                l2     tfidf, scaled so every\n"
+		<< "                                       document has length 1\n"
+		<< "  --from-csr=FILE             instead of reading text files, convert\n"
+		<< "                                the .csr file FILE to another format\n"
+		<< "  --records=FORMAT            how standard input is split into\n"
+		<< "                                documents:\n"
+		<< "                                whole      all of it is one (the\n"
+		<< "                                           default)\n"
+		<< "                                lines      one per line\n"
+		<< "                                delimited  separated by lines that\n"
+		<< "                                           are just --delimiter\n"
+		<< "                                length     each a line \"BYTES\" or\n"
+		<< "                                           \"BYTES NAME\", then that\n"
+		<< "                                           many bytes of text\n"
+		<< "                                jsonl      one JSON object per line,\n"
+		<< "                                           with a \"text\" string and\n"
+		<< "                                           a \"name\" or \"id\"\n"
+		<< "  --delimiter=TEXT            separate documents with lines of TEXT\n"
+		<< "                                (default ^^^^^^^^)\n"
+		<< "  --stream                    write each document from standard\n"
+		<< "                                input as soon as it is read, rather\n"
+		<< "                                than keeping them all.  Needs\n"
+		<< "                                --hash-dims, or an existing\n"
+		<< "                                --dictionary (which then doesn't\n"
+		<< "                                grow: new words are left out)\n"
 		<< "  -p, --porter-stem			  Use the porter-stemming algorithm\n"
+		<< "  --stemmer=NAME              stem words with NAME instead:\n"
+		<< "                                porter   the same as -p\n"
+		<< "                                english  Porter2 (or porter2)\n"
+		<< "                                german   Snowball German\n"
+		<< "                                french   Snowball French\n"
+		<< "                                auto     guess each document's\n"
+		<< "                                         language from its start\n"
+		<< "                                         and use english, german\n"
+		<< "                                         or french\n"
 		<< "  -w, --stop-words  		  Remove stop words\n"
+		<< "  --stop-list=FILE            remove the words listed in FILE instead\n"
+		<< "                                of the built-in stop words.  Words\n"
+		<< "                                are separated by whitespace, and '#'\n"
+		<< "                                starts a comment.\n"
+		<< "  --punctuation=POLICY        what to do with punctuation in words:\n"
+		<< "                                split  split words at it\n"
+		<< "                                drop   remove it (the default)\n"
+		<< "                                keep   keep apostrophes and hyphens\n"
+		<< "                                       inside words, remove the rest\n"
+		<< "                                legacy match spasmifytext's old output\n"
+		<< "  --keep-digits               treat digits as letters\n"
+		<< "  --file-list=FILE            also process the files named in FILE,\n"
+		<< "                                one per line (- reads the names from\n"
+		<< "                                standard input)\n"
+		<< "  --recursive=DIR             also process every file under DIR\n"
+		<< "                                (--recursive DIR works too)\n"
+		<< "  --prefetch=N                start reading the next N files while\n"
+		<< "                                the current ones are processed\n"
+		<< "                                (default 16, 0 doesn't)\n"
+		<< "  --threads=N                 process the input files with N threads\n"
+		<< "                                (0 uses every core).  The output is\n"
+		<< "                                the same for any number of threads.\n"
+		<< "  --memory-limit=SIZE         keep at most about SIZE bytes (K, M\n"
+		<< "                                or G may follow it) of word counts\n"
+		<< "                                in memory, moving the rest to\n"
+		<< "                                temporary files in $TMPDIR.  The\n"
+		<< "                                output is the same either way.\n"
+		<< "  --stem-cache=N              remember what the last N or so distinct\n"
+		<< "                                words stemmed to (default 65536,\n"
+		<< "                                0 turns the cache off)\n"
+		<< "  --write-threads=N           write the .spasms files with N\n"
+		<< "                                background threads (default 0\n"
+		<< "                                writes them one after another)\n"
+		<< "  --quiet                     don't say which file is being\n"
+		<< "                                processed, or how much memory\n"
+		<< "                                was used\n"
+		<< "  --stats[=FILE]              at the end, write a JSON report of\n"
+		<< "                                the time spent in each stage and\n"
+		<< "                                how much was read and written to\n"
+		<< "                                FILE (default standard output)\n"
 		<< endl
 		<< "All options with arguments require them." << endl
 		<< "Report bugs to <andersbe@gmail.com>." << endl
@@ -216,67 +353,1035 @@ void PrintDebug(set<string> filenames, Arguments args)
 	cout << "Output file:  " << args.outFile << endl;
 }
 
+// Counts a word against the current document of documents, given its id in
+// ngrams->Words(dictionary) (or dictionary), or its hash with --hash-dims.
+inline void CountWord(unsigned int term, TermDictionary& dictionary,
+	DocumentTable& documents, NgramCounter* ngrams)
+{
+	if (ngrams != NULL)
+	{
+		if (g_hasher != NULL)
+			ngrams->AddHashed(term, *g_hasher, documents);
+		else
+			ngrams->Add(term, dictionary, documents);
+	}
+	else if (g_hasher != NULL)
+	{
+		documents.AddTerm(g_hasher->Dimension(term));
+	}
+	else
+	{
+		documents.AddTerm(term);
+	}
+}
+
+// Tokens ProcessStream takes through its stages at a time, with --stats.
+const size_t BLOCK_TOKENS = 256;
+
+// A token of a block, and whether it's all lower case letters.
+struct BlockToken
+{
+	string_view token;
+	bool lower;
+};
+
+// A word on its way through ProcessStream's word level stages.
+struct StageWord
+{
+	string_view surface;	// as it was read, which the stem cache is keyed on
+	string_view word;		// what it has become so far
+	unsigned int term;
+	bool lower;				// surface is already lower case
+	bool known;				// term is known, from the stem cache
+
+	StageWord(string_view surface, bool lower) : surface(surface), 
+		word(surface), term(TermDictionary::NO_TERM), lower(lower), 
+		known(false) {}
+};
+
 /**
-* Takes an open input stream and an open output stream and processes
-* the input stream, adding entries for each new word found in it and 
-* incrementing entries for words already found.
+* Takes an open tokenizer and processes its input as a new document of 
+* documents, adding entries to dictionary for each new word found in it and 
+* counting the words against the document.  Returns the document's id.
+*
+* If cache isn't NULL, words are looked up in it before they are stemmed, 
+* and what they turn into is remembered there.  It must only ever be used 
+* with the same dictionary (and n-gram counter).
+*
+* With --stemmer=auto, the language of the document is guessed from the 
+* start of it, and its words are stemmed with the stemmer for that.
+*
+* If ngrams isn't NULL, the words go through it, which counts the n-grams 
+* they make up as well (or instead).
 */
-void ProcessStream(istream& in, const string& name, const Arguments& args)
+unsigned int ProcessStream(Tokenizer& in, const string& name, 
+	const Arguments& args, TermDictionary& dictionary, 
+	DocumentTable& documents, StemCache* cache, NgramCounter* ngrams)
 {
-	cout << "processing " << name << endl;
-	cout.flush();
-	string temp;
-	map<string, map<string, int> >::iterator wIter;
-	map<string, int>::iterator fIter;
-	while(in >> temp)
+	if (!args.quiet)
 	{
-		if (args.stem)
+		lock_guard<mutex> lock(g_coutLock);
+		cout << "processing " << name << '\n';
+	}
+	// Tokens point straight into the input.  Only the words that have to be
+	// changed are written out, into text, which like the rest of these is 
+	// kept per thread, so processing a block only allocates while they grow.
+	static thread_local vector<BlockToken> tokens;
+	static thread_local vector<StageWord> block;
+	static thread_local string text;
+	static thread_local vector<string_view> pieces;
+	TokenNormalizer normalizer(args.punctuation, args.keepDigits);
+	unsigned int doc = documents.BeginDocument(name);
+	TermDictionary& words = ngrams != NULL ? ngrams->Words(dictionary) : 
+		dictionary;
+	if (ngrams != NULL)
+		ngrams->Reset();
+
+	const Stemmer* stemmer = args.stemmer;
+	if (args.stem && args.detectLanguage)
+	{
+		string_view start = in.Peek(DETECT_BYTES);
+		Language language = DetectLanguage(start.data(), start.size());
+		stemmer = StemmerFor(language);
+		if (cache != NULL)
+			cache->SetVariant((unsigned char) language);
+	}
+
+	// What each word level stage does to a word.  Normalized and stemmed 
+	// words are written out at out, in text.
+	StageStats& stats = ThreadStats();
+	char* out = NULL;
+	auto lookUp = [&](StageWord& word)
+	{
+		word.known = cache->Lookup(word.surface.data(), word.surface.size(), 
+			word.term);
+	};
+	auto normalize = [&](StageWord& word)
+	{
+		if (word.known || word.lower)
+			return;
+		word.word = normalizer.Normalize(word.surface, out);
+		if (word.word.data() == out)
+			out += word.word.size();
+	};
+	auto stem = [&](StageWord& word)
+	{
+		// the stemmers work in place, and only ever shorten words
+		if (word.known || word.word.size() == 0)
+			return;
+		char* to = (char*) word.word.data();
+		if (word.word.data() == word.surface.data())
 		{
-			CallStemmer(temp);
+			to = out;
+			memcpy(to, word.word.data(), word.word.size());
+			out += word.word.size();
 		}
-		else
+		word.word = string_view(to, stemmer->Stem(to, word.word.size()));
+	};
+	auto stop = [&](StageWord& word)
+	{
+		if (!word.known && g_stopList.Contains(word.word))
+			word.word = string_view();
+	};
+	auto count = [&](StageWord& word)
+	{
+		if (!word.known)
 		{
-			ToLower(temp);
-			RemovePunct(temp);
+			// Look up (or create) the word's id, or hash it
+			string_view temp = word.word;
+			if (temp.size() == 0)
+				word.term = TermDictionary::NO_TERM;
+			else if (g_hasher != NULL)
+				word.term = g_hasher->HashWord(temp);
+			else if (g_fixedDictionary)
+				word.term = words.Find(temp.data(), temp.size());
+			else
+				word.term = words.Intern(temp.data(), temp.size());
+			if (cache != NULL)
+			{
+				cache->Insert(word.surface.data(), word.surface.size(), 
+					word.term);
+			}
+		}
+
+		// and count it against this file/stream
+		if (word.term != TermDictionary::NO_TERM)
+		{
+			CountWord(word.term, dictionary, documents, ngrams);
+			stats.counted++;
+		}
+	};
+
+	// Normalizing writes a word out at most half as long again, and stemming
+	// one that wasn't written out writes it out as it is, so text has room 
+	// for any words of this many bytes.
+	auto room = [&](size_t bytes)
+	{
+		if (text.size() < TokenNormalizer::Room(bytes) + bytes)
+			text.resize(TokenNormalizer::Room(bytes) + bytes);
+		out = &text[0];
+	};
+
+	if (!g_collectStats)
+	{
+		// each word goes through all the stages at once
+		string_view token;
+		bool lower;
+		while (in.Next(token, lower))
+		{
+			stats.tokens++;
+
+			// Splitting at punctuation can make several words out of one 
+			// token.  A token of lower case letters is always a word just as
+			// it is.
+			if (lower)
+			{
+				pieces.clear();
+				pieces.push_back(token);
+			}
+			else
+			{
+				normalizer.Split(token, pieces);
+			}
+			stats.words += pieces.size();
+
+			for (size_t piece = 0; piece < pieces.size(); piece++)
+			{
+				StageWord word(pieces[piece], lower);
+				room(word.surface.size());
+				if (cache != NULL)
+					lookUp(word);
+				normalize(word);
+				if (args.stem)
+					stem(word);
+				if (args.stopWords)
+					stop(word);
+				count(word);
+			}
+		}
+	}
+
+	// With --stats, tokens go through the stages a block at a time, each 
+	// stage over the whole block, so that a stage is timed once a block 
+	// instead of once a word.
+	StatsClock clock;
+	bool more = g_collectStats;
+	while (more)
+	{
+		clock = StatsNow();
+		tokens.clear();
+		BlockToken next;
+		while (tokens.size() < BLOCK_TOKENS && 
+			(more = in.Next(next.token, next.lower)))
+		{
+			tokens.push_back(next);
+		}
+		stats.tokens += tokens.size();
+		stats.Time(true, STAGE_TOKENIZE, clock);
+
+		block.clear();
+		size_t bytes = 0;
+		for (size_t i = 0; i < tokens.size(); i++)
+		{
+			bytes += tokens[i].token.size();
+			if (tokens[i].lower)
+			{
+				block.push_back(StageWord(tokens[i].token, true));
+				continue;
+			}
+			normalizer.Split(tokens[i].token, pieces);
+			for (size_t piece = 0; piece < pieces.size(); piece++)
+				block.push_back(StageWord(pieces[piece], false));
 		}
-		
+		stats.words += block.size();
+		stats.Time(true, STAGE_NORMALIZE, clock);
+
+		if (cache != NULL)
+		{
+			for (size_t i = 0; i < block.size(); i++)
+				lookUp(block[i]);
+			stats.Time(true, STAGE_CACHE, clock);
+		}
+
+		room(bytes);
+		for (size_t i = 0; i < block.size(); i++)
+			normalize(block[i]);
+		stats.Time(true, STAGE_NORMALIZE, clock);
+
+		if (args.stem)
+		{
+			for (size_t i = 0; i < block.size(); i++)
+				stem(block[i]);
+			stats.Time(true, STAGE_STEM, clock);
+		}
+
 		if (args.stopWords)
 		{
-			if (IsStopWord(temp))
-				temp = "";
+			for (size_t i = 0; i < block.size(); i++)
+				stop(block[i]);
+			stats.Time(true, STAGE_STOP, clock);
+		}
+
+		for (size_t i = 0; i < block.size(); i++)
+			count(block[i]);
+		stats.Time(true, STAGE_COUNT, clock);
+	}
+	documents.EndDocument();
+
+	stats.documents++;
+	stats.bytes += in.Bytes();
+	return doc;
+}
+
+// The term tables of one ingestion thread.  Term and document ids in them are
+// local to the thread until they are merged into g_dictionary/g_documents.
+class ThreadTables
+{
+public:
+	TermDictionary dictionary;
+	DocumentTable documents;
+	StemCache cache;
+	NgramCounter ngrams;
+	SpillFile* spill;		// NULL without --memory-limit
+	size_t spillLimit;
+	bool spillFailed;
+
+	ThreadTables(size_t cacheSize, const Arguments& args) : cache(cacheSize),
+		ngrams(args.ngramMin, args.ngramMax), spill(NULL), spillLimit(0), 
+		spillFailed(false)
+	{
+		if (args.hashBits > 0)
+			documents.SparseTerms();
+	};
+};
+
+// Spills the finished documents of documents to spill if their sparse 
+// vectors take more than limit bytes.  Returns false if they can't be 
+// written.
+bool SpillIfFull(DocumentTable& documents, SpillFile* spill, size_t limit)
+{
+	if (spill == NULL || documents.ResidentEntries() * sizeof(TermCount) <= limit)
+		return true;
+	return spill->Spill(documents);
+}
+
+// Gives up after a spill file couldn't be written.
+void SpillFailed()
+{
+	cerr << "spasmifytext: can't write a temporary file" << endl;
+	exit(1);
+}
+
+// Opens filename for ProcessStream, timing it for --stats.
+void OpenInput(Tokenizer& in, const string& filename)
+{
+	StatsClock clock;
+	if (g_collectStats)
+		clock = StatsNow();
+	in.Open(filename.c_str());
+	ThreadStats().Time(g_collectStats, STAGE_READ, clock);
+}
+
+// Adds the calling thread's --stats counters to g_stats, and starts them
+// over.
+void CollectStats()
+{
+	lock_guard<mutex> lock(g_statsLock);
+	g_stats.Add(ThreadStats());
+	ThreadStats() = StageStats();
+}
+
+// Returns the stem cache ProcessStream should use, or NULL if it shouldn't
+// use one.
+StemCache* CacheFor(ThreadTables& tables, const Arguments& args)
+{
+	if (args.stem && args.stemCache > 0)
+		return &tables.cache;
+	return NULL;
+}
+
+// Returns the n-gram counter ProcessStream should use, or NULL if only single
+// words are counted.
+NgramCounter* NgramsFor(ThreadTables& tables, const Arguments& args)
+{
+	return args.Ngrams() ? &tables.ngrams : NULL;
+}
+
+// The work shared by the ingestion threads: files are handed out one at a 
+// time to whichever thread is free, and each thread records where in its own
+// tables each file it processed ended up.
+class IngestJob
+{
+public:
+	const vector<string>* filenames;
+	const Arguments* args;
+	Prefetcher* prefetcher;
+	atomic<size_t> next;
+	vector<unsigned int> thread;	// file -> thread that processed it
+	vector<unsigned int> localDoc;	// file -> document id in that thread
+
+	IngestJob(const vector<string>& filenames, const Arguments& args,
+		Prefetcher& prefetcher) 
+		: filenames(&filenames), args(&args), prefetcher(&prefetcher), next(0), 
+		  thread(filenames.size()), localDoc(filenames.size()) {};
+};
+
+void IngestThread(IngestJob* job, unsigned int id, ThreadTables* tables)
+{
+	Tokenizer in;
+	while (true)
+	{
+		size_t file = job->next++;
+		if (file >= job->filenames->size())
+			break;
+
+		const string& name = (*job->filenames)[file];
+		job->prefetcher->Reached(file);
+		OpenInput(in, name);
+		job->localDoc[file] = ProcessStream(in, name, *job->args, 
+			tables->dictionary, tables->documents, CacheFor(*tables, *job->args),
+			NgramsFor(*tables, *job->args));
+		job->thread[file] = id;
+		in.Close();
+
+		if (!SpillIfFull(tables->documents, tables->spill, tables->spillLimit))
+		{
+			tables->spillFailed = true;
+			break;
+		}
+	}
+	CollectStats();
+}
+
+/**
+* Processes every file into g_dictionary and g_documents, using args.threads
+* threads.  
+*
+* With more than one thread, each thread counts the files it is handed into 
+* its own ThreadTables, and the tables are then merged one file at a time in
+* filename order.  Since every sparse vector keeps its terms in the order 
+* they were first seen, interning them in that order during the merge hands
+* out exactly the same term and document ids as a single threaded run.
+*/
+void ProcessFiles(const vector<string>& filenames, const Arguments& args)
+{
+	unsigned int threads = args.threads;
+	if (threads == 0)
+		threads = max(thread::hardware_concurrency(), 1u);
+	if (threads > filenames.size())
+		threads = max((unsigned int) filenames.size(), 1u);
+	g_threads = threads;
+
+	// the cache isn't used at all without stemming, so don't allocate it
+	size_t cacheSize = args.stem ? args.stemCache : 0;
+
+	// with a memory limit, every thread's tables and the merged tables each
+	// get an equal share of it
+	SpillFile* spill = args.memoryLimit > 0 ? &g_spill : NULL;
+	size_t spillLimit = args.memoryLimit / (threads == 1 ? 1 : threads + 1);
+
+	// the next few files are read in while the current ones are tokenized
+	Prefetcher prefetcher(filenames, PREFETCH_THREADS, args.prefetch);
+
+	if (threads == 1)
+	{
+		StemCache cache(cacheSize);
+		NgramCounter ngrams(args.ngramMin, args.ngramMax);
+		Tokenizer in;
+		for (size_t file = 0; file < filenames.size(); file++)
+		{
+			prefetcher.Reached(file);
+			OpenInput(in, filenames[file]);
+
+			unsigned int doc = ProcessStream(in, filenames[file], args, 
+				g_dictionary, g_documents, cacheSize > 0 ? &cache : NULL,
+				args.Ngrams() ? &ngrams : NULL);
+			in.Close();
+			g_frequencies.Count(g_documents.Begin(doc), g_documents.End(doc));
+
+			if (!SpillIfFull(g_documents, spill, spillLimit))
+				SpillFailed();
+		}
+		g_stemCacheHits += cache.Hits();
+		g_stemCacheMisses += cache.Misses();
+		return;
+	}
+
+	IngestJob job(filenames, args, prefetcher);
+	deque<ThreadTables> tables;
+	for (unsigned int id = 0; id < threads; id++)
+		tables.emplace_back(cacheSize, args);
+	vector<SpillFile> spills(spill != NULL ? threads : 0);
+	for (unsigned int id = 0; id < spills.size(); id++)
+	{
+		tables[id].spill = &spills[id];
+		tables[id].spillLimit = spillLimit;
+	}
+
+	vector<thread> workers;
+	for (unsigned int id = 0; id < threads; id++)
+		workers.push_back(thread(IngestThread, &job, id, &tables[id]));
+	for (unsigned int id = 0; id < threads; id++)
+	{
+		workers[id].join();
+		g_stemCacheHits += tables[id].cache.Hits();
+		g_stemCacheMisses += tables[id].cache.Misses();
+		if (tables[id].spillFailed)
+			SpillFailed();
+	}
+
+	// Each thread spilled its documents in the order it was handed them, so
+	// the spilled ones can be read back from the start of its file as the
+	// merge comes to them.
+	for (unsigned int id = 0; id < spills.size(); id++)
+	{
+		if (tables[id].documents.FirstResident() > 0 && !spills[id].Rewind())
+			SpillFailed();
+	}
+	vector<TermCount> spilled;
+	StatsClock clock;
+	if (g_collectStats)
+		clock = StatsNow();
+
+	// local term id -> global term id, for each thread
+	vector<vector<unsigned int> > globalTerm(threads);
+	for (unsigned int id = 0; id < threads; id++)
+		globalTerm[id].assign(tables[id].dictionary.Size(), 
+			TermDictionary::NO_TERM);
+
+	for (size_t file = 0; file < filenames.size(); file++)
+	{
+		ThreadTables& local = tables[job.thread[file]];
+		vector<unsigned int>& toGlobal = globalTerm[job.thread[file]];
+		unsigned int doc = job.localDoc[file];
+
+		const TermCount* begin;
+		const TermCount* end;
+		if (doc < local.documents.FirstResident())
+		{
+			unsigned int spilledDoc;
+			if (!local.spill->Read(spilledDoc, spilled) || spilledDoc != doc)
+			{
+				cerr << "spasmifytext: can't read a temporary file" << endl;
+				exit(1);
+			}
+			begin = spilled.data();
+			end = spilled.data() + spilled.size();
 		}
-		
-		if (temp.size() == 0)
-			;
 		else
 		{
-			// Check for presence of word
-			wIter = g_words.find(temp);
+			begin = local.documents.Begin(doc);
+			end = local.documents.End(doc);
+		}
 
-			// If it already exists, check to see if we've already found it in this 
-			// file/stream
-			if (wIter != g_words.end())
+		unsigned int merged = g_documents.BeginDocument(filenames[file]);
+		for (const TermCount* entry = begin; entry != end; entry++)
+		{
+			// hashed dimensions are the same in every thread
+			unsigned int term = entry->term;
+			if (g_hasher == NULL)
 			{
-				fIter = wIter->second.find(name);
-				// If it does, increment the count
-				if (fIter != wIter->second.end())
+				unsigned int& global = toGlobal[entry->term];
+				if (global == TermDictionary::NO_TERM)
 				{
-					fIter->second++;
-				}
-				// Otherwise create it and set it's count to 1
-				else
-				{
-					wIter->second.insert(make_pair(name,1));
+					string_view word = local.dictionary.Term(entry->term);
+					global = g_dictionary.Intern(word.data(), word.size());
 				}
+				term = global;
 			}
-			else // If it doesn't exist, create it, and add an entry for this file/stream
-			{
-				map<string, int> tempMap;
-				tempMap.insert(make_pair(name,1));
-				g_words.insert(make_pair(temp,tempMap));
-			}
+			g_documents.AddTerm(term, entry->count);
+		}
+		g_documents.EndDocument();
+		g_frequencies.Count(g_documents.Begin(merged), g_documents.End(merged));
+
+		if (!SpillIfFull(g_documents, spill, spillLimit))
+			SpillFailed();
+	}
+	ThreadStats().Time(g_collectStats, STAGE_MERGE, clock);
+}
+
+// Sets mainName to the name of the main output file, and title to the
+// (as it always has been) collection name written at its top.
+void OutputNames(const Arguments& args, string& mainName, string& title)
+{
+	mainName = title = args.outFile;
+	if (args.outFile == "")
+	{
+		mainName = args.singleFile ? "a.edsf" : "a.edmf";
+		title = "a.edsf";
+		if (args.format == FORMAT_CSR)
+			mainName = title = "a.csr";
+	}
+}
+
+/**
+* Writes the text formats: the main .edsf or .edmf file, with the dimension
+* mapping at its top, and every document's datapoint either in it or in a 
+* .spasms file of its own.  Datapoints are written one at a time as they are
+* handed over, so they can be streamed.
+*/
+class TextOutput
+{
+public:
+	TextOutput(const Arguments& args) : m_args(args), m_writer(NULL), 
+		m_spasms(64 << 10), m_nonZeros(0) {};
+	~TextOutput() { delete m_writer; }
+
+	// Creates mainName and writes title and the dimension mapping, dimension
+	// d being the word order[d] of g_dictionary (or, with --hash-dims, just
+	// a number).  Returns false if it can't be created.
+	bool Open(const string& mainName, const string& title, 
+		const vector<unsigned int>& order);
+
+	// Writes a document's datapoint from its sparse vector, which holds 
+	// dimensions in order.  The values are the counts, or the weights from
+	// weigher if it isn't NULL.
+	void Write(string_view name, const TermCount* begin, const TermCount* end,
+		const Weigher* weigher);
+	// The same with the given weights, one for each entry, or the counts if
+	// weights is NULL.
+	void Write(string_view name, const TermCount* begin, const TermCount* end,
+		const float* weights);
+
+	// Hands the datapoints written so far to the operating system.
+	void Flush() { if (!m_out.Flush()) Fail(m_out.Name()); }
+
+	// Remembers the first file that couldn't be written (or read).
+	void Fail(const string& what) { if (m_failed == "") m_failed = what; }
+
+	// Finishes every file.  Returns false, after saying which, if any of 
+	// them couldn't be written.
+	bool Close();
+
+	// The values written so far.
+	unsigned long long NonZeros() const { return m_nonZeros; }
+
+	// The bytes written, once Close() has been called.
+	unsigned long long Written() const 
+		{ return m_out.Written() + m_spasms.Written(); }
+
+private:
+	const Arguments& m_args;
+	OutputFile m_out;
+	AsyncWriter* m_writer;
+	OutputFile m_spasms;		// one buffer is reused for every .spasms file
+	vector<float> m_weights;
+	string m_failed;
+	unsigned long long m_nonZeros;
+};
+
+bool TextOutput::Open(const string& mainName, const string& title,
+					  const vector<unsigned int>& order)
+{
+	if (!m_out.Open(mainName))
+	{
+		cerr << "spasmifytext: can't write " << mainName << endl;
+		return false;
+	}
+	m_out.Write(title);
+	m_out.Write("\n^^^^^^^^\nText data\n^^^^^^^^\n");
+
+	// output the dimension mapping; hashed dimensions have no words, just the
+	// number of them and the seed they were hashed with
+	if (g_hasher != NULL)
+	{
+		m_out.Write("hashed\t");
+		m_out.WriteNumber(g_hasher->Dimensions());
+		m_out.Write('\t');
+		m_out.WriteNumber(g_hasher->Seed());
+		m_out.Write('\n');
+	}
+	else for (unsigned int dimension = 0; dimension < order.size(); dimension++)
+	{
+		m_out.Write('\t');
+		m_out.WriteNumber(dimension);
+		m_out.Write('\t');
+		m_out.Write(g_dictionary.Term(order[dimension]));
+		m_out.Write('\n');
+	}
+
+	if (!m_args.singleFile)
+	{
+		m_out.Write("^^^^^^^^\n");
+		if (m_args.writeThreads > 0)
+			m_writer = new AsyncWriter(m_args.writeThreads);
+	}
+	return true;
+}
+
+void TextOutput::Write(string_view name, const TermCount* begin, 
+					   const TermCount* end, const Weigher* weigher)
+{
+	const float* weights = NULL;
+	if (weigher != NULL)
+	{
+		weigher->Weigh(begin, end, m_weights);
+		weights = m_weights.data();
+	}
+	Write(name, begin, end, weights);
+}
+
+// output a datapoint, straight from its sparse vector
+void TextOutput::Write(string_view name, const TermCount* begin, 
+					   const TermCount* end, const float* weights)
+{
+	OutputFile* datapoint = &m_out;
+	if (m_args.singleFile)
+	{
+		m_out.Write("^^^^^^^^\n");
+		m_out.Write(name);
+		m_out.Write("\n^^^^^^^^\n");
+	}
+	else
+	{
+		m_out.Write(name);
+		m_out.Write(".spasms\n");
+		datapoint = &m_spasms;
+		if (!m_spasms.Open(string(name) + ".spasms", m_writer))
+			Fail(m_spasms.Name());
+	}
+
+	m_nonZeros += end - begin;
+	for (const TermCount* entry = begin; entry != end; entry++)
+	{
+		datapoint->WriteNumber(entry->term);
+		datapoint->Write('\t');
+		if (weights != NULL)
+			datapoint->WriteFloat(weights[entry - begin]);
+		else
+			datapoint->WriteNumber(entry->count);
+		datapoint->Write('\n');
+	}
+	if (!m_args.singleFile && !m_spasms.Close())
+		Fail(m_spasms.Name());
+}
+
+bool TextOutput::Close()
+{
+	if (!m_out.Close())
+		Fail(m_out.Name());
+	if (m_writer != NULL)
+	{
+		string asyncFailed;
+		if (!m_writer->Finish(asyncFailed))
+			Fail(asyncFailed);
+		delete m_writer;
+		m_writer = NULL;
+	}
+
+	if (m_failed != "")
+	{
+		cerr << "spasmifytext: can't write " << m_failed << endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+* Writes the collection description, dimension mapping and datapoints for 
+* everything in g_dictionary and g_documents, either to a single .edsf file,
+* to an .edmf file plus a .spasms file per document, or to a .csr file.
+*
+* Each datapoint is written straight from its document's sparse vector, so
+* this takes time in proportion to the number of non-zero counts rather than
+* documents times words.  Everything goes through OutputFile buffers, so a
+* .spasms file is normally a single write(); with --write-threads the
+* .spasms files are written by background threads while the rest are
+* formatted.  Returns false, after saying which file, if anything couldn't be
+* written.
+*/
+bool WriteOutput(const Arguments& args)
+{
+	string mainName, title;
+	OutputNames(args, mainName, title);
+
+	// Dimensions are numbered in alphabetical order of the words, except
+	// that those of a .csr file or a --dictionary are kept as they were (and
+	// new words are added after them), which makes them the term ids. 
+	// Remember each term id's dimension.  With --hash-dims, the documents
+	// already hold dimensions, and there are far too many of them to have
+	// anything for each, so order and dimensionOf stay empty.
+	vector<unsigned int> order;
+	if (args.fromCsr != "" || args.dictionary != "")
+	{
+		for (unsigned int term = 0; term < g_dictionary.Size(); term++)
+			order.push_back(term);
+	}
+	else if (g_hasher == NULL)
+	{
+		g_dictionary.SortedOrder(order);
+	}
+
+	// the words pruned from the vocabulary get no dimension at all
+	if (args.Prune())
+	{
+		g_frequencies.Prune(order, g_documents.Size(), args.minDf, args.maxDf,
+			args.maxFeatures);
+	}
+	vector<unsigned int> dimensionOf;
+	if (g_hasher == NULL)
+	{
+		dimensionOf.assign(g_dictionary.Size(), TermDictionary::NO_TERM);
+		for (unsigned int dimension = 0; dimension < order.size(); 
+			dimension++)
+			dimensionOf[order[dimension]] = dimension;
+	}
+
+	// from here on every document's sparse vector holds dimensions, in order
+	if (g_hasher != NULL)
+		g_documents.Sort();
+	else
+		g_documents.Renumber(dimensionOf);
+
+	// spilled documents are read back in order as they are written
+	DocumentReader documents(g_documents, g_spill, dimensionOf);
+
+	Weigher weigher = g_hasher != NULL ? 
+		Weigher(args.weighting, g_frequencies, g_documents.Size()) :
+		Weigher(args.weighting, g_frequencies, order, g_documents.Size());
+	bool weighted = args.weighting != WEIGHT_COUNT;
+	if (weighted && !weigher.Measure(documents))
+	{
+		cerr << "spasmifytext: can't read a temporary file" << endl;
+		return false;
+	}
+
+	g_dimensions = g_hasher != NULL ? g_hasher->Dimensions() : order.size();
+	if (args.format == FORMAT_CSR)
+	{
+		if (WriteCsr(mainName, title, g_hasher != NULL ? NULL : &g_dictionary,
+			order, g_hasher, documents, weighted ? &weigher : NULL))
+		{
+			struct stat info;
+			g_nonZeros = documents.NonZeros();
+			if (stat(mainName.c_str(), &info) == 0)
+				g_bytesWritten = info.st_size;
+			return true;
+		}
+		cerr << "spasmifytext: can't write " << mainName << endl;
+		return false;
+	}
+
+	TextOutput out(args);
+	if (!out.Open(mainName, title, order))
+		return false;
+
+	if (!documents.Rewind())
+		out.Fail("a temporary file");
+	for (unsigned int doc = 0; doc < g_documents.Size(); doc++)
+	{
+		const TermCount* begin;
+		const TermCount* end;
+		if (!documents.Next(begin, end))
+		{
+			out.Fail("a temporary file");
+			begin = end = NULL;
+		}
+		out.Write(g_documents.Name(doc), begin, end, 
+			weighted ? &weigher : NULL);
+	}
+	bool closed = out.Close();
+	g_nonZeros = out.NonZeros();
+	g_bytesWritten = out.Written();
+	return closed;
+}
+
+/**
+* Writes a .csr file that holds weights to the text formats, as they are.
+* The file's rows were loaded into g_documents, with its dimensions, but the
+* weights can't go there, so they come straight from the file.  Returns
+* false, after saying which file, if anything couldn't be written.
+*/
+bool WriteCsrWeights(const Arguments& args, const CsrFile& csr)
+{
+	string mainName, title;
+	OutputNames(args, mainName, title);
+
+	vector<unsigned int> order;
+	for (unsigned int term = 0; term < g_dictionary.Size(); term++)
+		order.push_back(term);
+	g_dimensions = g_hasher != NULL ? g_hasher->Dimensions() : order.size();
+
+	TextOutput out(args);
+	if (!out.Open(mainName, title, order))
+		return false;
+	for (unsigned int doc = 0; doc < g_documents.Size(); doc++)
+	{
+		out.Write(g_documents.Name(doc), g_documents.Begin(doc), 
+			g_documents.End(doc), csr.Weights() + csr.RowPointers()[doc]);
+	}
+	bool closed = out.Close();
+	g_nonZeros = out.NonZeros();
+	g_bytesWritten = out.Written();
+	return closed;
+}
+
+/**
+* Processes standard input: as one document named STDIN, or split into 
+* documents as args.records says.  The documents go into g_documents to be 
+* written out with everything else, unless args.stream, in which case each 
+* one's datapoint is written as soon as it is finished and then forgotten,
+* so that any number of them can be piped through in a fixed amount of 
+* memory.  Returns false if the input is malformed, or the output can't be
+* written.
+*/
+bool ProcessStandardInput(const Arguments& args)
+{
+	size_t cacheSize = args.stem ? args.stemCache : 0;
+	StemCache cache(cacheSize);
+	NgramCounter ngrams(args.ngramMin, args.ngramMax);
+	SpillFile* spill = args.memoryLimit > 0 ? &g_spill : NULL;
+
+	// Streaming needs every dimension before the first document is read:
+	// they are the hashed ones, or the term ids of a dictionary that doesn't
+	// grow any more.
+	TextOutput out(args);
+	vector<unsigned int> order;
+	vector<TermCount> sorted;
+	Weigher weigher(args.weighting, g_frequencies, order, 0);
+	bool weighted = args.weighting != WEIGHT_COUNT;
+	if (args.stream)
+	{
+		g_fixedDictionary = g_hasher == NULL;
+		for (unsigned int term = 0; term < g_dictionary.Size(); term++)
+			order.push_back(term);
+		g_dimensions = g_hasher != NULL ? g_hasher->Dimensions() : order.size();
+		string mainName, title;
+		OutputNames(args, mainName, title);
+		if (!out.Open(mainName, title, order))
+			return false;
+	}
+
+	Tokenizer in;
+	RecordReader records(args.records, args.delimiter);
+	if (args.records != RECORDS_WHOLE)
+		records.Open(0);
+	for (size_t count = 0; ; count++)
+	{
+		string_view name = "STDIN";
+		StatsClock clock;
+		if (g_collectStats)
+			clock = StatsNow();
+		if (args.records == RECORDS_WHOLE)
+		{
+			if (count > 0)
+				break;
+			in.Open(0);
+		}
+		else
+		{
+			string_view text;
+			if (!records.Next(name, text))
+				break;
+			in.Open(text.data(), text.size());
+		}
+		ThreadStats().Time(g_collectStats, STAGE_READ, clock);
+
+		unsigned int doc = ProcessStream(in, string(name), args, g_dictionary,
+			g_documents, cacheSize > 0 ? &cache : NULL, 
+			args.Ngrams() ? &ngrams : NULL);
+		in.Close();
+		if (!args.stream)
+		{
+			g_frequencies.Count(g_documents.Begin(doc), g_documents.End(doc));
+			if (!SpillIfFull(g_documents, spill, args.memoryLimit))
+				SpillFailed();
+			continue;
 		}
-	} 
+
+		// the terms are already dimensions, but in the order they were seen
+		sorted.assign(g_documents.Begin(doc), g_documents.End(doc));
+		sort(sorted.begin(), sorted.end(), 
+			[](const TermCount& a, const TermCount& b) 
+			{ return a.term < b.term; });
+		if (g_collectStats)
+			clock = StatsNow();
+		out.Write(name, sorted.data(), sorted.data() + sorted.size(),
+			weighted ? &weigher : NULL);
+		out.Flush();
+		ThreadStats().Time(g_collectStats, STAGE_WRITE, clock);
+		g_documents.Clear();
+	}
+	g_stemCacheHits += cache.Hits();
+	g_stemCacheMisses += cache.Misses();
+
+	bool read = records.Error() == "";
+	if (!read)
+	{
+		cerr << "spasmifytext: standard input " << records.Error() << endl;
+	}
+	if (args.stream)
+	{
+		bool closed = out.Close();
+		g_nonZeros = out.NonZeros();
+		g_bytesWritten = out.Written();
+		return closed && read;
+	}
+	return read;
+}
+
+/**
+* Writes the --stats report, a JSON object, to standard output or the file
+* args.stats: the time spent in each stage (added up over the threads, so
+* they can come to more than the seconds the run took), how much was read,
+* tokenized and counted, and how much was written.  Returns false if the
+* file can't be written.
+*/
+bool WriteStats(const Arguments& args, double seconds)
+{
+	ofstream file;
+	if (args.stats != "-")
+	{
+		file.open(args.stats.c_str());
+		if (!file)
+		{
+			cerr << "spasmifytext: can't write " << args.stats << endl;
+			return false;
+		}
+	}
+	ostream& out = args.stats == "-" ? cout : file;
+
+	uint64_t documents = args.stream ? g_stats.documents : g_documents.Size();
+
+	out << "{\n"
+		<< "  \"seconds\": " << seconds << ",\n"
+		<< "  \"threads\": " << g_threads << ",\n"
+		<< "  \"documents\": " << documents << ",\n"
+		<< "  \"bytes_read\": " << g_stats.bytes << ",\n"
+		<< "  \"tokens\": " << g_stats.tokens << ",\n"
+		<< "  \"words\": " << g_stats.words << ",\n"
+		<< "  \"words_counted\": " << g_stats.counted << ",\n"
+		<< "  \"dictionary_words\": " << g_dictionary.Size() << ",\n"
+		<< "  \"dimensions\": " << g_dimensions << ",\n"
+		<< "  \"non_zeros\": " << g_nonZeros << ",\n"
+		<< "  \"bytes_written\": " << g_bytesWritten << ",\n"
+		<< "  \"output\": ";
+	string mainName, title;
+	OutputNames(args, mainName, title);
+	WriteJsonString(out, mainName.c_str());
+	out << ",\n  \"stages\": {";
+	for (int stage = 0; stage < STAGES; stage++)
+	{
+		out << (stage > 0 ? ", " : " ");
+		WriteJsonString(out, StageName((Stage) stage));
+		out << ": " << g_stats.seconds[stage];
+	}
+	out << " },\n"
+		<< "  \"arenas\": { \"dictionary_bytes\": " 
+		<< g_dictionary.ArenaBytes() << ", \"document_name_bytes\": " 
+		<< g_documents.ArenaBytes() << " },\n"
+		<< "  \"spill\": { \"bytes\": " << g_spill.Bytes() 
+		<< ", \"runs\": " << g_spill.Runs() << " },\n"
+		<< "  \"stem_cache\": { \"hits\": " << g_stemCacheHits 
+		<< ", \"misses\": " << g_stemCacheMisses << " }\n"
+		<< "}" << endl;
+
+	if (!out)
+	{
+		cerr << "spasmifytext: can't write " << args.stats << endl;
+		return false;
+	}
+	return true;
 }
 
 int main(int argc, char* argv[])
@@ -284,6 +1389,9 @@ int main(int argc, char* argv[])
 	// Store filenames in a set so we don't process the same file twice, doubling
 	// its word counts.
 	set<string> filenames;
+	// and the other places they come from (see inputs.h)
+	vector<string> fileLists;
+	vector<string> directories;
 
 	// The name for the main Enchilada data format file (suffix will be generated
 	// automatically)
@@ -308,14 +1416,109 @@ int main(int argc, char* argv[])
 				{
 					args.singleFile = true;
 				}
-				if (strcmp("--porter-stem",argv[i]) == 0)
+				else if (strcmp("--porter-stem",argv[i]) == 0)
 				{
 					args.stem = true;
+					args.stemmer = FindStemmer("porter");
+					args.detectLanguage = false;
 				}
-				if (strcmp("--stop-words",argv[i]) == 0)
+				else if (strncmp("--stemmer=",argv[i],
+					strlen("--stemmer=")) == 0)
+				{
+					const char* name = argv[i] + strlen("--stemmer=");
+					args.stem = true;
+					args.detectLanguage = strcmp(name, "auto") == 0;
+					if (!args.detectLanguage)
+					{
+						args.stemmer = FindStemmer(name);
+						if (args.stemmer == NULL)
+							unrecognized = true;
+					}
+				}
+				else if (strcmp("--stop-words",argv[i]) == 0)
 				{
 					args.stopWords = true;
 				}
+				else if (strncmp("--punctuation=",argv[i],
+					strlen("--punctuation=")) == 0)
+				{
+					if (!ParsePunctuationPolicy(argv[i] + strlen("--punctuation="),
+						args.punctuation))
+						unrecognized = true;
+				}
+				else if (strncmp("--stop-list=",argv[i],
+					strlen("--stop-list=")) == 0)
+				{
+					args.stopWords = true;
+					args.stopList = argv[i] + strlen("--stop-list=");
+
+					if (args.stopList.length() == 0)
+						unrecognized = true;
+				}
+				else if (strncmp("--format=",argv[i],
+					strlen("--format=")) == 0)
+				{
+					const char* format = argv[i] + strlen("--format=");
+					if (strcmp(format, "text") == 0)
+						args.format = FORMAT_TEXT;
+					else if (strcmp(format, "csr") == 0)
+						args.format = FORMAT_CSR;
+					else
+						unrecognized = true;
+				}
+				else if (strncmp("--ngrams=",argv[i],
+					strlen("--ngrams=")) == 0)
+				{
+					if (!ParseNgramRange(argv[i] + strlen("--ngrams="),
+						args.ngramMin, args.ngramMax))
+						unrecognized = true;
+				}
+				else if (strncmp("--hash-dims=",argv[i],
+					strlen("--hash-dims=")) == 0)
+				{
+					if (!ParseHashDimensions(argv[i] + strlen("--hash-dims="),
+						args.hashBits))
+						unrecognized = true;
+				}
+				else if (strncmp("--hash-seed=",argv[i],
+					strlen("--hash-seed=")) == 0)
+				{
+					const char* value = argv[i] + strlen("--hash-seed=");
+					char* end;
+					unsigned long seed = strtoul(value, &end, 10);
+
+					if (*value == '\0' || *end != '\0' || seed > 0xffffffffUL)
+						unrecognized = true;
+					else
+						args.hashSeed = (uint32_t) seed;
+				}
+				else if (strncmp("--weight=",argv[i],
+					strlen("--weight=")) == 0)
+				{
+					if (!ParseWeighting(argv[i] + strlen("--weight="),
+						args.weighting))
+						unrecognized = true;
+				}
+				else if (strncmp("--from-csr=",argv[i],
+					strlen("--from-csr=")) == 0)
+				{
+					args.fromCsr = argv[i] + strlen("--from-csr=");
+
+					if (args.fromCsr.length() == 0)
+						unrecognized = true;
+				}
+				else if (strncmp("--dictionary=",argv[i],
+					strlen("--dictionary=")) == 0)
+				{
+					args.dictionary = argv[i] + strlen("--dictionary=");
+
+					if (args.dictionary.length() == 0)
+						unrecognized = true;
+				}
+				else if (strcmp("--keep-digits",argv[i]) == 0)
+				{
+					args.keepDigits = true;
+				}
 				else if (strcmp("--help",argv[i]) == 0)
 				{
 					help = true;
@@ -329,6 +1532,140 @@ int main(int argc, char* argv[])
 					if (args.outFile.length() == 0)
 						unrecognized = true;
 				}
+				else if (strncmp("--stem-cache=",argv[i],
+					strlen("--stem-cache=")) == 0)
+				{
+					const char* value = argv[i] + strlen("--stem-cache=");
+					char* end;
+					long size = strtol(value, &end, 10);
+
+					if (*value == '\0' || *end != '\0' || size < 0)
+						unrecognized = true;
+					else
+						args.stemCache = (size_t) size;
+				}
+				else if (strncmp("--memory-limit=",argv[i],
+					strlen("--memory-limit=")) == 0)
+				{
+					if (!ParseSize(argv[i] + strlen("--memory-limit="),
+						args.memoryLimit) || args.memoryLimit == 0)
+						unrecognized = true;
+				}
+				else if (strncmp("--min-df=",argv[i],
+					strlen("--min-df=")) == 0)
+				{
+					if (!args.minDf.Parse(argv[i] + strlen("--min-df=")))
+						unrecognized = true;
+				}
+				else if (strncmp("--max-df=",argv[i],
+					strlen("--max-df=")) == 0)
+				{
+					if (!args.maxDf.Parse(argv[i] + strlen("--max-df=")))
+						unrecognized = true;
+				}
+				else if (strncmp("--max-features=",argv[i],
+					strlen("--max-features=")) == 0)
+				{
+					const char* value = argv[i] + strlen("--max-features=");
+					char* end;
+					long features = strtol(value, &end, 10);
+
+					if (*value == '\0' || *end != '\0' || features <= 0)
+						unrecognized = true;
+					else
+						args.maxFeatures = (size_t) features;
+				}
+				else if (strncmp("--records=",argv[i],
+					strlen("--records=")) == 0)
+				{
+					if (!ParseRecordFormat(argv[i] + strlen("--records="),
+						args.records))
+						unrecognized = true;
+				}
+				else if (strncmp("--delimiter=",argv[i],
+					strlen("--delimiter=")) == 0)
+				{
+					args.delimiter = argv[i] + strlen("--delimiter=");
+					args.records = RECORDS_DELIMITED;
+				}
+				else if (strcmp("--stream",argv[i]) == 0)
+				{
+					args.stream = true;
+				}
+				else if (strcmp("--quiet",argv[i]) == 0)
+				{
+					args.quiet = true;
+				}
+				else if (strcmp("--stats",argv[i]) == 0)
+				{
+					args.stats = "-";
+				}
+				else if (strncmp("--stats=",argv[i],
+					strlen("--stats=")) == 0)
+				{
+					args.stats = argv[i] + strlen("--stats=");
+					if (args.stats == "")
+						unrecognized = true;
+				}
+				else if (strcmp("--approximate-df",argv[i]) == 0)
+				{
+					args.approximateDf = true;
+				}
+				else if (strncmp("--file-list=",argv[i],
+					strlen("--file-list=")) == 0)
+				{
+					fileLists.push_back(argv[i] + strlen("--file-list="));
+					if (fileLists.back() == "")
+						unrecognized = true;
+				}
+				else if (strncmp("--recursive=",argv[i],
+					strlen("--recursive=")) == 0)
+				{
+					directories.push_back(argv[i] + strlen("--recursive="));
+					if (directories.back() == "")
+						unrecognized = true;
+				}
+				else if (strcmp("--recursive",argv[i]) == 0)
+				{
+					if (i + 1 < argc)
+						directories.push_back(argv[++i]);
+					else
+						unrecognized = true;
+				}
+				else if (strncmp("--prefetch=",argv[i],
+					strlen("--prefetch=")) == 0)
+				{
+					const char* value = argv[i] + strlen("--prefetch=");
+					char* end;
+					long files = strtol(value, &end, 10);
+
+					if (*value == '\0' || *end != '\0' || files < 0)
+						unrecognized = true;
+					else
+						args.prefetch = (size_t) files;
+				}
+				else if (strncmp("--threads=",argv[i],
+					strlen("--threads=")) == 0)
+				{
+					const char* value = argv[i] + strlen("--threads=");
+					char* end;
+					args.threads = (int) strtol(value, &end, 10);
+
+					if (*value == '\0' || *end != '\0' || args.threads < 0)
+						unrecognized = true;
+				}
+				else if (strncmp("--write-threads=",argv[i],
+					strlen("--write-threads=")) == 0)
+				{
+					const char* value = argv[i] + strlen("--write-threads=");
+					char* end;
+					long threads = strtol(value, &end, 10);
+
+					if (*value == '\0' || *end != '\0' || threads < 0)
+						unrecognized = true;
+					else
+						args.writeThreads = (unsigned int) threads;
+				}
 				else
 				{
 					unrecognized = true;
@@ -346,6 +1683,8 @@ int main(int argc, char* argv[])
 						break;
 					case 'p':
 						args.stem = true;
+						args.stemmer = FindStemmer("porter");
+						args.detectLanguage = false;
 						break;
 					case 'w':
 						args.stopWords = true;
@@ -366,7 +1705,26 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	if (filenames.size() == 0)
+	// a .csr file replaces the input files, and has its own dimensions, and
+	// so does a dictionary, which pruning would leave gaps in.  Hashing
+	// has neither words nor a dictionary to prune.  Without either, the 
+	// input is standard input, unless that is a terminal, and it can only 
+	// be streamed into dimensions that are all known up front.
+	bool listed = fileLists.size() > 0 || directories.size() > 0;
+	bool standardInput = filenames.size() == 0 && !listed && 
+		args.fromCsr == "";
+	if (((filenames.size() > 0 || listed) && args.fromCsr != "") ||
+		(standardInput && isatty(0) && args.records == RECORDS_WHOLE) ||
+		(!standardInput && (args.records != RECORDS_WHOLE || args.stream)) ||
+		(args.stream && ((args.hashBits == 0 && 
+			(args.dictionary == "" || args.Ngrams())) || 
+			args.format != FORMAT_TEXT || NeedsFrequencies(args.weighting))) ||
+		(args.fromCsr != "" && args.dictionary != "") ||
+		(args.dictionary != "" && args.Prune()) ||
+		(args.hashBits > 0 && (args.fromCsr != "" || args.dictionary != "" ||
+			args.Prune())) ||
+		(args.approximateDf && args.maxFeatures == 0) ||
+		(args.approximateDf && NeedsFrequencies(args.weighting)))
 		unrecognized = true;
 
 	// A command was malformed, or they asked for help, just print usage and 
@@ -384,101 +1742,176 @@ int main(int argc, char* argv[])
 		exit(0);
 	}
 
-	// read from standard input if they don't give any.
-	if (filenames.size() == 0)
+	vector<string> listedNames;
+	for (size_t i = 0; i < fileLists.size(); i++)
 	{
-		ProcessStream(cin, "STDIN", args);
+		if (!ReadFileList(fileLists[i].c_str(), listedNames))
+		{
+			cerr << "spasmifytext: can't read file list " << fileLists[i] 
+				<< endl;
+			exit(1);
+		}
 	}
-	// otherwise, process the files they input
-	else
+	for (size_t i = 0; i < directories.size(); i++)
 	{
-		set<string>::iterator fIter;
-		for (fIter = filenames.begin(); fIter != filenames.end(); fIter++)
+		if (!WalkDirectory(directories[i], listedNames))
 		{
-			ifstream fin(fIter->c_str());
-
-			ProcessStream(fin, *fIter, args);
-			fin.close();
+			cerr << "spasmifytext: can't read directory " << directories[i] 
+				<< endl;
+			exit(1);
 		}
 	}
+	filenames.insert(listedNames.begin(), listedNames.end());
 
-	// work with pointers so we can use the same file to output in either
-	// single file or mutli file format
-	ofstream* out;
-	if (args.outFile != "")
+	if (args.stopList != "" && !g_stopList.Load(args.stopList.c_str()))
 	{
-		out = new ofstream(args.outFile.c_str());
-		*out << args.outFile << endl << "^^^^^^^^" << endl;
+		cerr << "spasmifytext: can't read stop list " << args.stopList << endl;
+		exit(1);
 	}
-	else 
+
+	// A .csr file of hashed dimensions is read as if they had just been
+	// hashed, into as many dimensions with the same seed, and like them
+	// they can't be pruned.  One of weights can only be written out as it
+	// is, as text.
+	CsrFile csr;
+	if (args.fromCsr != "")
 	{
-		if (args.singleFile)
+		if (!csr.Open(args.fromCsr.c_str()))
 		{
-			out = new ofstream("a.edsf");
-			*out << "a.edsf" << endl << "^^^^^^^^" << endl;
+			cerr << "spasmifytext: " << args.fromCsr 
+				<< " isn't a readable .csr file" << endl;
+			exit(1);
 		}
-		else
+		if (csr.Hashed() && args.Prune())
+		{
+			cerr << "spasmifytext: " << args.fromCsr 
+				<< " has hashed dimensions, which can't be pruned" << endl;
+			exit(1);
+		}
+		if (csr.Weighted() && (args.format != FORMAT_TEXT || 
+			args.weighting != WEIGHT_COUNT || args.Prune()))
+		{
+			cerr << "spasmifytext: " << args.fromCsr << " holds weights, "
+				<< "which can only be written out as text, as they are" 
+				<< endl;
+			exit(1);
+		}
+		if (csr.Hashed())
 		{
-			out = new ofstream("a.edmf");
-			*out << "a.edsf" << endl << "^^^^^^^^" << endl;
+			while ((1ull << args.hashBits) < csr.Columns())
+				args.hashBits++;
+			args.hashSeed = csr.HashSeed();
 		}
 	}
-	*out << "Text data" << endl <<  "^^^^^^^^" <<  endl;
-	ofstream* main = out;
 
-	// output the dimension mapping
-	map<string, map<string, int> >::iterator outerIt;
-	int dimension = 0; 
-	for (outerIt = g_words.begin(); outerIt != g_words.end(); outerIt++)
+	// Count document frequencies as documents are finished if they will be
+	// needed.  A few times as many candidates as words wanted is plenty for
+	// the frequent ones to stand out.
+	if (args.approximateDf)
+		g_frequencies.Approximate(4 * args.maxFeatures);
+	else if (args.Prune() || NeedsFrequencies(args.weighting))
+		g_frequencies.Enable(args.hashBits > 0);
+
+	// the first run with a dictionary creates it
+	if (args.dictionary != "" && access(args.dictionary.c_str(), F_OK) == 0 &&
+		!g_dictionary.Load(args.dictionary.c_str()))
 	{
-		*out << "\t" << dimension << "\t" << outerIt->first << endl;
-		dimension++;
+		cerr << "spasmifytext: " << args.dictionary 
+			<< " isn't a readable dictionary file" << endl;
+		exit(1);
 	}
-	if (!args.singleFile)
+	size_t knownTerms = g_dictionary.Size();
+
+	// streaming can't add words to a dictionary, so it has to exist already
+	if (args.stream && args.dictionary != "" && 
+		access(args.dictionary.c_str(), F_OK) != 0)
 	{
-		*out << "^^^^^^^^" << endl;
+		cerr << "spasmifytext: --stream needs an existing dictionary, not "
+			<< args.dictionary << endl;
+		exit(1);
 	}
+	bool written = true;
+	g_collectStats = args.stats != "";
+	StatsClock started = StatsNow();
 
-	// output individual datapoints
-	set<string>::iterator fIter;
-	for (fIter = filenames.begin(); fIter != filenames.end(); fIter++)
+	FeatureHasher hasher(args.hashBits, args.hashSeed);
+	if (args.hashBits > 0)
 	{
-		if (args.singleFile)
+		g_hasher = &hasher;
+		g_documents.SparseTerms();
+	}
+
+	if (args.fromCsr != "")
+	{
+		if (!csr.Load(g_dictionary, g_documents))
 		{
-			*out << "^^^^^^^^" << endl;
-			*out << *fIter << endl;
-			*out << "^^^^^^^^" << endl;
+			cerr << "spasmifytext: " << args.fromCsr 
+				<< " isn't a readable .csr file" << endl;
+			exit(1);
 		}
+		for (unsigned int doc = 0; doc < g_documents.Size(); doc++)
+			g_frequencies.Count(g_documents.Begin(doc), g_documents.End(doc));
+	}
+	// read from standard input if they don't give any.
+	else if (standardInput)
+	{
+		written = ProcessStandardInput(args);
+		if (!written && !args.stream)
+			exit(1);
+	}
+	// otherwise, process the files they input
+	else
+	{
+		ProcessFiles(vector<string>(filenames.begin(), filenames.end()), args);
+	}
+
+	if (!args.stream)
+	{
+		StatsClock clock;
+		if (g_collectStats)
+			clock = StatsNow();
+		if (args.fromCsr != "" && csr.Weighted())
+			written = WriteCsrWeights(args, csr);
 		else
+			written = WriteOutput(args);
+		ThreadStats().Time(g_collectStats, STAGE_WRITE, clock);
+	}
+
+	if (args.dictionary != "" && g_dictionary.Size() > knownTerms &&
+		!g_dictionary.Save(args.dictionary.c_str()))
+	{
+		cerr << "spasmifytext: can't write " << args.dictionary << endl;
+		written = false;
+	}
+
+	// the report has all of these in it
+	if (args.stats != "")
+	{
+		CollectStats();
+		if (!WriteStats(args, Lap(started)))
+			written = false;
+	}
+	else if (!args.quiet)
+	{
+		if (g_spill.Runs() > 0)
 		{
-			*out << *fIter << ".spasms" << endl;
-			out = new ofstream((*fIter + ".spasms").c_str());
-		}
-		dimension = 0;
-		for (outerIt = g_words.begin(); outerIt != g_words.end(); outerIt++)
-		{
-			map<string, int>::iterator innerIt;
-			innerIt = outerIt->second.find(*fIter);
-			if (innerIt != outerIt->second.end())
-			{
-				*out << dimension << "\t" << innerIt->second << endl;
-			}
-			dimension++;
+			cout << "spilled " << g_spill.Bytes() << " bytes in " 
+				<< g_spill.Runs() << " runs" << endl;
 		}
-		if (!args.singleFile)
+
+		if (g_stemCacheHits + g_stemCacheMisses > 0)
 		{
-			out->close();
-			delete out;
-			out = main;
+			cout << "stem cache: " << g_stemCacheHits << " hits, " 
+				<< g_stemCacheMisses << " misses" << endl;
 		}
 	}
-	out->close();
-	delete out;
 
 #ifdef DEBUG  
 	// Print the arguments for debugging.
 	PrintDebug(filenames, args);
 #endif
+
+	return written ? 0 : 1;
 }
 
 
@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// spill.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of spill files and reading documents back.  See spill.h.
+//
+// A run is a sequence of documents, each stored as its id and number of
+// entries (two unsigned ints) followed by its TermCounts, all in the host's
+// byte order: the file never outlives the process.
+///////////////////////////////////////////////////////////////////////////////
+#include "spill.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+using namespace std;
+
+static const size_t SPILL_BUFFER = 1 << 20;
+
+SpillFile::SpillFile()
+{
+	m_file = NULL;
+	m_runs = 0;
+	m_bytes = 0;
+}
+
+SpillFile::~SpillFile()
+{
+	if (m_file != NULL)
+		fclose(m_file);
+}
+
+bool SpillFile::Spill(DocumentTable& documents)
+{
+	if (m_file == NULL)
+	{
+		const char* directory = getenv("TMPDIR");
+		string name = string(directory != NULL && *directory != '\0' ?
+			directory : "/tmp") + "/spasmifytext.XXXXXX";
+		int fd = mkstemp(&name[0]);
+		if (fd < 0)
+			return false;
+		// nobody else needs to see it, and this way it can't be left behind
+		unlink(name.c_str());
+		m_file = fdopen(fd, "w+b");
+		if (m_file == NULL)
+		{
+			close(fd);
+			return false;
+		}
+		m_buffer.resize(SPILL_BUFFER);
+		setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+	}
+
+	for (unsigned int doc = documents.FirstResident(); doc < documents.Size();
+		doc++)
+	{
+		unsigned int header[2] = { doc, (unsigned int) documents.Entries(doc) };
+		if (fwrite(header, sizeof(header), 1, m_file) != 1 ||
+			fwrite(documents.Begin(doc), sizeof(TermCount), header[1], m_file)
+			!= header[1])
+			return false;
+		m_bytes += sizeof(header) + header[1] * sizeof(TermCount);
+	}
+	m_runs++;
+	documents.DropFinished();
+	return true;
+}
+
+bool SpillFile::Rewind()
+{
+	return m_file != NULL && fflush(m_file) == 0 &&
+		fseek(m_file, 0, SEEK_SET) == 0;
+}
+
+bool SpillFile::Read(unsigned int& doc, vector<TermCount>& entries)
+{
+	unsigned int header[2];
+	if (m_file == NULL || fread(header, sizeof(header), 1, m_file) != 1)
+		return false;
+
+	doc = header[0];
+	entries.resize(header[1]);
+	return fread(entries.data(), sizeof(TermCount), header[1], m_file) ==
+		header[1];
+}
+
+DocumentReader::DocumentReader(const DocumentTable& documents,
+							   SpillFile& spilled,
+							   const vector<unsigned int>& dimensionOf)
+{
+	m_documents = &documents;
+	m_spilled = &spilled;
+	m_dimensionOf = &dimensionOf;
+	m_next = 0;
+	m_nonZeros = 0;
+}
+
+bool DocumentReader::Rewind()
+{
+	m_next = 0;
+	m_nonZeros = 0;
+	return m_documents->FirstResident() == 0 || m_spilled->Rewind();
+}
+
+static bool TermCountLess(const TermCount& a, const TermCount& b)
+{
+	return a.term < b.term;
+}
+
+bool DocumentReader::Next(const TermCount*& begin, const TermCount*& end)
+{
+	unsigned int doc = m_next;
+	if (doc >= m_documents->Size())
+		return false;
+	m_next++;
+
+	if (doc >= m_documents->FirstResident())
+	{
+		begin = m_documents->Begin(doc);
+		end = m_documents->End(doc);
+	}
+	else
+	{
+		unsigned int spilledDoc;
+		if (!m_spilled->Read(spilledDoc, m_entries) || spilledDoc != doc)
+			return false;
+
+		if (!m_dimensionOf->empty())
+		{
+			for (size_t i = 0; i < m_entries.size(); i++)
+				m_entries[i].term = (*m_dimensionOf)[m_entries[i].term];
+		}
+		sort(m_entries.begin(), m_entries.end(), TermCountLess);
+		begin = m_entries.data();
+		end = m_entries.data() + m_entries.size();
+	}
+
+	// pruned terms sort to the end
+	while (end != begin && end[-1].term == TermDictionary::NO_TERM)
+		end--;
+	m_nonZeros += end - begin;
+	return true;
+}
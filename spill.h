@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// spill.h
+///////////////////////////////////////////////////////////////////////////////
+// Spilling documents' sparse vectors to disk, for --memory-limit.
+//
+// Once a DocumentTable's sparse vectors take up more memory than allowed,
+// every finished document is appended to a SpillFile as one run of (document
+// id, term id, count) records and dropped from memory.  A table only ever
+// spills whole documents, and always in document order, so reading its
+// SpillFile back from the start gives the documents in order and merging the
+// runs of several tables is a matter of reading each file in turn, in the
+// order the documents were handed out, rather than sorting.  The records
+// keep the order the terms were first seen in, so the merged ids come out
+// exactly as if nothing had been spilled.
+//
+// A DocumentReader gives the writers every document's sparse vector in order
+// whether it was spilled or not.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+#include "termdict.h"
+
+class SpillFile
+{
+public:
+	SpillFile();
+	~SpillFile();
+
+	// Appends every finished document of documents that is still resident,
+	// as one run, and drops them from documents.  The temporary file is
+	// created (in $TMPDIR, or /tmp) the first time.  Returns false if it
+	// can't be written.
+	bool Spill(DocumentTable& documents);
+
+	// Starts reading the spilled documents from the first one.  Returns
+	// false if nothing was spilled or the file can't be read.
+	bool Rewind();
+
+	// Reads the next spilled document's sparse vector into entries, and sets
+	// doc to its id.  Returns false at the end of the file, or if it can't be
+	// read.
+	bool Read(unsigned int& doc, std::vector<TermCount>& entries);
+
+	size_t Runs() const { return m_runs; }
+	size_t Bytes() const { return m_bytes; }
+
+private:
+	FILE* m_file;
+	std::vector<char> m_buffer;	// stdio's buffer
+	size_t m_runs;
+	size_t m_bytes;
+
+	// not copyable: it owns the file
+	SpillFile(const SpillFile&);
+	SpillFile& operator=(const SpillFile&);
+};
+
+class DocumentReader
+{
+public:
+	// Reads the documents of documents, those before FirstResident() from
+	// spilled, numbering spilled terms with dimensionOf the same way
+	// documents.Renumber(dimensionOf) numbered the resident ones.  An empty
+	// dimensionOf leaves the terms as they are, for when they already are
+	// dimensions (with --hash-dims) and documents.Sort() was used instead.
+	DocumentReader(const DocumentTable& documents, SpillFile& spilled,
+		const std::vector<unsigned int>& dimensionOf);
+
+	const DocumentTable& Documents() const { return *m_documents; }
+
+	// Starts over at document 0.  Returns false if the spilled documents
+	// can't be read.
+	bool Rewind();
+
+	// Sets [begin, end) to the next document's sparse vector, in order of
+	// dimension and leaving out the terms whose dimension is
+	// TermDictionary::NO_TERM (those pruned from the vocabulary).  Returns
+	// false after the last document, or if it can't be read.
+	bool Next(const TermCount*& begin, const TermCount*& end);
+
+	// The number of entries Next() has handed out since Rewind().
+	size_t NonZeros() const { return m_nonZeros; }
+
+private:
+	const DocumentTable* m_documents;
+	SpillFile* m_spilled;
+	const std::vector<unsigned int>* m_dimensionOf;
+	unsigned int m_next;
+	size_t m_nonZeros;
+	std::vector<TermCount> m_entries;
+};
+
+#endif
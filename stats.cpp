@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// stats.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the --stats counters.  See stats.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "stats.h"
+
+#include <stdio.h>
+using namespace std;
+
+bool g_collectStats = false;
+
+StageStats::StageStats()
+{
+	for (int s = 0; s < STAGES; s++)
+		seconds[s] = 0;
+	documents = bytes = tokens = words = counted = 0;
+}
+
+void StageStats::Add(const StageStats& other)
+{
+	for (int s = 0; s < STAGES; s++)
+		seconds[s] += other.seconds[s];
+	documents += other.documents;
+	bytes += other.bytes;
+	tokens += other.tokens;
+	words += other.words;
+	counted += other.counted;
+}
+
+StageStats& ThreadStats()
+{
+	static thread_local StageStats stats;
+	return stats;
+}
+
+const char* StageName(Stage stage)
+{
+	static const char* const NAMES[STAGES] = { "read", "tokenize",
+		"normalize", "cache", "stem", "stopwords", "count", "merge",
+		"write" };
+	return NAMES[stage];
+}
+
+void WriteJsonString(ostream& out, const char* text)
+{
+	out << '"';
+	for (const char* p = text; *p != '\0'; p++)
+	{
+		unsigned char c = (unsigned char) *p;
+		if (c == '"' || c == '\\')
+			out << '\\' << (char) c;
+		else if (c < 0x20)
+		{
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			out << escape;
+		}
+		else
+			out << (char) c;
+	}
+	out << '"';
+}
@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// stats.h
+///////////////////////////////////////////////////////////////////////////////
+// Counters and timers for --stats: where a run spends its time, stage by
+// stage, and how much it processed.
+//
+// Every thread counts into its own StageStats (see ThreadStats()), with no
+// locking, and they are added up when the thread is done.  The file level
+// stages (opening and mapping a file, merging, writing) are timed directly.
+// The word level stages (tokenizing, normalizing, stemming, stop words,
+// counting) take tens of nanoseconds a word, about what reading the clock
+// does, so with --stats words go through them a block of tokens at a time,
+// and each stage is timed once a block (see ProcessStream()).  Otherwise
+// each word goes through all of them in turn.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+
+typedef std::chrono::steady_clock::time_point StatsClock;
+
+inline StatsClock StatsNow() { return std::chrono::steady_clock::now(); }
+
+// Seconds since start, moving start on to now.
+inline double Lap(StatsClock& start)
+{
+	StatsClock now = StatsNow();
+	double seconds = std::chrono::duration<double>(now - start).count();
+	start = now;
+	return seconds;
+}
+
+enum Stage
+{
+	STAGE_READ,			// opening and mapping (or reading) files
+	STAGE_TOKENIZE,
+	STAGE_NORMALIZE,
+	STAGE_CACHE,		// looking words up in the stem cache
+	STAGE_STEM,
+	STAGE_STOP,
+	STAGE_COUNT,
+	STAGE_MERGE,		// merging the tables of several threads
+	STAGE_WRITE,		// numbering, pruning, weighting and writing the output
+	STAGES
+};
+
+class StageStats
+{
+public:
+	StageStats();
+
+	void Add(const StageStats& other);
+
+	// Adds the time since clock to stage, if it's being timed.
+	void Time(bool timed, Stage stage, StatsClock& clock)
+		{ if (timed) seconds[stage] += Lap(clock); }
+
+	double seconds[STAGES];
+
+	uint64_t documents;
+	uint64_t bytes;				// of input
+	uint64_t tokens;
+	uint64_t words;				// after splitting at punctuation
+	uint64_t counted;			// words counted (the rest were stop words,
+								// or nothing was left of them)
+};
+
+// The calling thread's StageStats.
+StageStats& ThreadStats();
+
+// Whether to collect stats at all.  Without --stats nothing is timed.
+extern bool g_collectStats;
+
+// The name of a stage in the JSON summary.
+const char* StageName(Stage stage);
+
+// Writes text as a JSON string.
+void WriteJsonString(std::ostream& out, const char* text);
+
+#endif
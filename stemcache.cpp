@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// stemcache.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the surface form -> term id cache.  See stemcache.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "stemcache.h"
+#include "termdict.h"
+
+#include <string.h>
+using namespace std;
+
+StemCache::StemCache(size_t capacity)
+{
+	size_t slots = 1;
+	while (slots < capacity)
+		slots *= 2;
+
+	Slot empty;
+	memset(&empty, 0, sizeof(empty));
+	m_slots.assign(slots, empty);
+	m_hits = 0;
+	m_misses = 0;
+	m_variant = 0;
+}
+
+// The slot word[0..length) lives in under the current variant.  Each variant
+// spreads the words over the slots differently, so that they don't all
+// compete for the same slots.
+inline StemCache::Slot& StemCache::SlotFor(const char* word, size_t length)
+{
+	size_t hash = TermDictionary::Hash(word, length) ^ 
+		(m_variant * (size_t) 0x9e3779b9);
+	return m_slots[hash & (m_slots.size() - 1)];
+}
+
+bool StemCache::Lookup(const char* word, size_t length, unsigned int& term)
+{
+	if (length == 0 || length > MAX_WORD)
+	{
+		m_misses++;
+		return false;
+	}
+
+	const Slot& slot = SlotFor(word, length);
+	if (slot.length == length && slot.variant == m_variant &&
+		memcmp(slot.word, word, length) == 0)
+	{
+		m_hits++;
+		term = slot.term;
+		return true;
+	}
+	m_misses++;
+	return false;
+}
+
+void StemCache::Insert(const char* word, size_t length, unsigned int term)
+{
+	if (length == 0 || length > MAX_WORD)
+		return;
+
+	Slot& slot = SlotFor(word, length);
+	slot.term = term;
+	slot.length = (unsigned char) length;
+	slot.variant = m_variant;
+	memcpy(slot.word, word, length);
+}
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// stemcache.h
+///////////////////////////////////////////////////////////////////////////////
+// A bounded cache from the surface form of a token (exactly as it was read
+// from the input) to the term id it ended up as after lower casing, 
+// punctuation removal, stemming and stop word removal.
+//
+// Word frequencies are very skewed, so a few thousand surface forms make up
+// most of the tokens in a corpus.  Remembering what they turned into means
+// the stemmer only runs about once per distinct word instead of once per
+// token.
+//
+// The cache is direct mapped: each surface form can only live in the one
+// slot its hash picks, and a new form simply replaces whatever was there.
+// Slots hold the surface form inline, so nothing is allocated after the
+// cache is constructed, and forms too long to fit are never cached.  A cache
+// maps to the term ids of one TermDictionary, so each ingestion thread has
+// its own.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef STEMCACHE_H
+#define STEMCACHE_H
+
+#include <stddef.h>
+#include <vector>
+
+class StemCache
+{
+public:
+	// capacity is the number of slots, rounded up to a power of two.
+	StemCache(size_t capacity);
+
+	// If word[0..length) is cached, sets term to what it turned into (which
+	// is TermDictionary::NO_TERM for words that were dropped entirely) and
+	// returns true.
+	bool Lookup(const char* word, size_t length, unsigned int& term);
+
+	// Remembers that word[0..length) turned into term.
+	void Insert(const char* word, size_t length, unsigned int term);
+
+	// Keeps what words turn into under each variant (such as the stemmer
+	// used for a document's language) apart.  Lookup() and Insert() use the
+	// variant set last, 0 to begin with.
+	void SetVariant(unsigned char variant) { m_variant = variant; }
+
+	size_t Hits() const { return m_hits; }
+	size_t Misses() const { return m_misses; }
+
+private:
+	// Longest surface form that is cached.  Makes a slot 32 bytes.
+	static const size_t MAX_WORD = 26;
+
+	struct Slot
+	{
+		unsigned int term;
+		unsigned char length;	// 0 when the slot is empty
+		unsigned char variant;
+		char word[MAX_WORD];
+	};
+
+	Slot& SlotFor(const char* word, size_t length);
+
+	std::vector<Slot> m_slots;
+	unsigned char m_variant;
+	size_t m_hits;
+	size_t m_misses;
+};
+
+#endif
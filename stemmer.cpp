@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+// stemmer.cpp
+///////////////////////////////////////////////////////////////////////////////
+// The table of stemmers.  See stemmer.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "stemmer.h"
+#include "snowball.h"
+#include "porter.h"
+
+#include <string.h>
+using namespace std;
+
+// The original Porter stemmer of porter.cpp.
+class Porter : public Stemmer
+{
+public:
+	size_t Stem(char* word, size_t length) const
+	{
+		if (length == 0)
+			return 0;
+		return stem(word, 0, (int) length - 1) + 1;
+	}
+
+	const char* Name() const { return "porter"; }
+};
+
+static const Porter s_porter;
+
+const Stemmer* FindStemmer(const char* name)
+{
+	const Stemmer* stemmers[] = { &s_porter, &EnglishStemmer(),
+		&GermanStemmer(), &FrenchStemmer() };
+	if (strcmp(name, "porter2") == 0)
+		return &EnglishStemmer();
+	for (const Stemmer* stemmer : stemmers)
+	{
+		if (strcmp(name, stemmer->Name()) == 0)
+			return stemmer;
+	}
+	return NULL;
+}
+
+const Stemmer* StemmerFor(Language language)
+{
+	switch (language)
+	{
+	case LANGUAGE_GERMAN:
+		return &GermanStemmer();
+	case LANGUAGE_FRENCH:
+		return &FrenchStemmer();
+	default:
+		return &EnglishStemmer();
+	}
+}
@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// stemmer.h
+///////////////////////////////////////////////////////////////////////////////
+// The stemmers words can be run through (--stemmer=NAME, or -p for the
+// original Porter stemmer):
+//
+//   porter    Porter's 1980 algorithm, as in porter.cpp (what -p always was)
+//   english   Porter2, the revised English stemmer of the Snowball project
+//   german    the Snowball German stemmer
+//   french    the Snowball French stemmer
+//
+// Each works in place on a lower case UTF-8 word and only ever shortens it,
+// so a stemmer never allocates and any number of threads can share one.  The
+// Snowball stemmers work on words of up to SnowballWord::MAX_LENGTH
+// characters (see snowball.h) and leave longer ones, or ones that aren't
+// valid UTF-8, as they are.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef STEMMER_H
+#define STEMMER_H
+
+#include <stddef.h>
+#include "langdetect.h"
+
+class Stemmer
+{
+public:
+	virtual ~Stemmer() {}
+
+	// Stems word[0..length) in place and returns the length of the stem,
+	// which is never more than length.
+	virtual size_t Stem(char* word, size_t length) const = 0;
+
+	// The name --stemmer knows it by.
+	virtual const char* Name() const = 0;
+};
+
+// The stemmer called name (or "porter2", for english), or NULL if there
+// isn't one.
+const Stemmer* FindStemmer(const char* name);
+
+// The stemmer for a language DetectLanguage() picked.
+const Stemmer* StemmerFor(Language language);
+
+#endif
@@ -0,0 +1,267 @@
+///////////////////////////////////////////////////////////////////////////////
+// stopwords.cpp
+///////////////////////////////////////////////////////////////////////////////
+// The built-in stop word list, and building perfect hash tables for it (at
+// compile time) and for loaded lists (at run time).  See stopwords.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "stopwords.h"
+#include "unicode.h"
+
+#include <ctype.h>
+#include <algorithm>
+#include <array>
+#include <fstream>
+using namespace std;
+
+// The words IsStopWord() used to check for, in the same order.
+static constexpr array<string_view, 34> BUILT_IN_WORDS = {
+	"the", "a", "and", "or", "then", "that", "of", "for", "by", "as", "be",
+	"this", "we", "which", "with", "at", "from", "such", "there", "if", "is",
+	"it", "to", "but", "those", "their", "theirs", "them", "they", "too",
+	"was", "were", "who", "whose"
+};
+
+static constexpr size_t BUILT_IN_BUCKETS = 16;
+static constexpr size_t BUILT_IN_SLOTS = 64;
+
+// Give up on a bucket after trying this many seeds for it.
+static const uint32_t MAX_SEED = 1 << 20;
+
+class BuiltInTable
+{
+public:
+	array<uint32_t, BUILT_IN_BUCKETS> seeds;
+	array<int, BUILT_IN_SLOTS> slots;
+	bool built;
+};
+
+// The compile time version of StopList::Build(), for the built-in list.  It
+// finds each bucket's members by looking through the whole list, which is
+// fine for a few dozen words.
+static constexpr BuiltInTable BuildBuiltInTable()
+{
+	BuiltInTable table = {};
+	table.built = false;
+	for (size_t slot = 0; slot < BUILT_IN_SLOTS; slot++)
+		table.slots[slot] = -1;
+
+	array<uint64_t, BUILT_IN_WORDS.size()> hashes = {};
+	for (size_t i = 0; i < BUILT_IN_WORDS.size(); i++)
+		hashes[i] = HashStopWord(BUILT_IN_WORDS[i]);
+
+	// place the biggest buckets first, while most of the slots are free
+	for (size_t size = BUILT_IN_WORDS.size(); size > 0; size--)
+	{
+		for (size_t bucket = 0; bucket < BUILT_IN_BUCKETS; bucket++)
+		{
+			array<size_t, BUILT_IN_WORDS.size()> members = {};
+			size_t count = 0;
+			for (size_t i = 0; i < BUILT_IN_WORDS.size(); i++)
+			{
+				if (StopBucket(hashes[i], BUILT_IN_BUCKETS - 1) == bucket)
+					members[count++] = i;
+			}
+			if (count != size)
+				continue;
+
+			uint32_t seed = 0;
+			while (true)
+			{
+				if (++seed == MAX_SEED)
+					return table;
+
+				size_t placed = 0;
+				while (placed < count)
+				{
+					size_t slot = StopSlot(hashes[members[placed]], seed, 
+						BUILT_IN_SLOTS - 1);
+					if (table.slots[slot] != -1)
+						break;
+					table.slots[slot] = (int) members[placed];
+					placed++;
+				}
+				if (placed == count)
+					break;
+
+				// take back what this seed placed, and try the next one
+				for (size_t i = 0; i < placed; i++)
+				{
+					table.slots[StopSlot(hashes[members[i]], seed, 
+						BUILT_IN_SLOTS - 1)] = -1;
+				}
+			}
+			table.seeds[bucket] = seed;
+		}
+	}
+	table.built = true;
+	return table;
+}
+
+static constexpr BuiltInTable BUILT_IN_TABLE = BuildBuiltInTable();
+static_assert(BUILT_IN_TABLE.built, 
+	"no perfect hash found for the built-in stop words");
+
+StopList::StopList()
+{
+	m_words = BUILT_IN_WORDS.data();
+	m_seeds = BUILT_IN_TABLE.seeds.data();
+	m_slots = BUILT_IN_TABLE.slots.data();
+	m_size = BUILT_IN_WORDS.size();
+	m_bucketMask = BUILT_IN_BUCKETS - 1;
+	m_slotMask = BUILT_IN_SLOTS - 1;
+}
+
+// Case folds word the way tokens are: each UTF-8 character to what 
+// FoldCodePoint() says.  Bytes that aren't valid UTF-8 are left as they are.
+static string FoldWord(const string& word)
+{
+	string folded;
+	size_t i = 0;
+	while (i < word.size())
+	{
+		char32_t c, to;
+		size_t size = DecodeUtf8(word.data() + i, word.size() - i, c);
+		if (size == 0)
+		{
+			folded += word[i++];
+			continue;
+		}
+		FoldCodePoint(c, to);
+		char bytes[4];
+		folded.append(bytes, EncodeUtf8(to, bytes));
+		i += size;
+	}
+	return folded;
+}
+
+bool StopList::Load(const char* filename)
+{
+	ifstream in(filename);
+	if (!in)
+		return false;
+
+	m_storage.clear();
+	string line;
+	while (getline(in, line))
+	{
+		size_t comment = line.find('#');
+		if (comment != string::npos)
+			line.erase(comment);
+
+		size_t i = 0;
+		while (i < line.size())
+		{
+			while (i < line.size() && isspace((unsigned char) line[i]))
+				i++;
+			size_t start = i;
+			while (i < line.size() && !isspace((unsigned char) line[i]))
+				i++;
+			if (i > start)
+				m_storage.push_back(FoldWord(line.substr(start, i - start)));
+		}
+	}
+
+	// a perfect hash needs every word to be different
+	sort(m_storage.begin(), m_storage.end());
+	m_storage.erase(unique(m_storage.begin(), m_storage.end()), 
+		m_storage.end());
+
+	Build();
+	return true;
+}
+
+// Orders buckets by how many words are in them, biggest first.
+class BucketSizeGreater
+{
+public:
+	BucketSizeGreater(const vector<vector<size_t> >& members) 
+		: m_members(members) {}
+	bool operator()(size_t a, size_t b) const
+	{
+		return m_members[a].size() > m_members[b].size();
+	}
+private:
+	const vector<vector<size_t> >& m_members;
+};
+
+// Builds the perfect hash of m_storage: about four words per bucket, and
+// at least twice as many slots as words, so a seed that places a bucket
+// is quick to find.
+void StopList::Build()
+{
+	size_t words = m_storage.size();
+	size_t buckets = 1;
+	while (buckets * 4 < words)
+		buckets *= 2;
+	size_t slots = 2;
+	while (slots < words * 2)
+		slots *= 2;
+
+	vector<uint64_t> hashes(words);
+	vector<vector<size_t> > members(buckets);
+	m_views.resize(words);
+	for (size_t i = 0; i < words; i++)
+	{
+		m_views[i] = m_storage[i];
+		hashes[i] = HashStopWord(m_views[i]);
+		members[StopBucket(hashes[i], buckets - 1)].push_back(i);
+	}
+
+	vector<size_t> order(buckets);
+	for (size_t bucket = 0; bucket < buckets; bucket++)
+		order[bucket] = bucket;
+	stable_sort(order.begin(), order.end(), BucketSizeGreater(members));
+
+	while (true)
+	{
+		m_seedTable.assign(buckets, 0);
+		m_slotTable.assign(slots, -1);
+
+		bool placedAll = true;
+		for (size_t b = 0; b < buckets && placedAll; b++)
+		{
+			const vector<size_t>& bucket = members[order[b]];
+			if (bucket.empty())
+				break;
+
+			uint32_t seed = 0;
+			while (true)
+			{
+				if (++seed == MAX_SEED)
+				{
+					placedAll = false;
+					break;
+				}
+
+				size_t placed = 0;
+				while (placed < bucket.size())
+				{
+					size_t slot = StopSlot(hashes[bucket[placed]], seed, 
+						slots - 1);
+					if (m_slotTable[slot] != -1)
+						break;
+					m_slotTable[slot] = (int) bucket[placed];
+					placed++;
+				}
+				if (placed == bucket.size())
+					break;
+
+				for (size_t i = 0; i < placed; i++)
+					m_slotTable[StopSlot(hashes[bucket[i]], seed, slots - 1)] = -1;
+			}
+			m_seedTable[order[b]] = seed;
+		}
+		if (placedAll)
+			break;
+
+		// Practically never happens, but more room always works eventually.
+		slots *= 2;
+	}
+
+	m_words = m_views.data();
+	m_seeds = m_seedTable.data();
+	m_slots = m_slotTable.data();
+	m_size = words;
+	m_bucketMask = buckets - 1;
+	m_slotMask = slots - 1;
+}
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// stopwords.h
+///////////////////////////////////////////////////////////////////////////////
+// Stop word lists stored as perfect hash tables, so that checking a word is
+// one hash of it plus at most one comparison, however long the list is.
+//
+// The tables use "hash and displace": a word's hash picks a bucket, each
+// bucket has its own seed, and the hash mixed with that seed picks the
+// word's slot.  The seeds are chosen, biggest bucket first, so that no two
+// words share a slot.
+//
+// The built-in list is turned into a table at compile time.  Lists loaded
+// with Load() (for --stop-list) are turned into one when they are loaded.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef STOPWORDS_H
+#define STOPWORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 64 bit FNV-1a of word.
+constexpr uint64_t HashStopWord(std::string_view word)
+{
+	uint64_t h = 14695981039346656037ull;
+	for (size_t i = 0; i < word.size(); i++)
+	{
+		h ^= (unsigned char) word[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// The bucket of a word with the given hash.
+constexpr size_t StopBucket(uint64_t hash, size_t bucketMask)
+{
+	return (size_t) (hash >> 40) & bucketMask;
+}
+
+// The slot of a word with the given hash, in a bucket with the given seed.
+constexpr size_t StopSlot(uint64_t hash, uint32_t seed, size_t slotMask)
+{
+	uint64_t x = hash + seed * 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return (size_t) (x ^ (x >> 31)) & slotMask;
+}
+
+class StopList
+{
+public:
+	// Starts out as the built-in list.
+	StopList();
+
+	// Replaces the list with the words in filename, separated by whitespace.
+	// Everything from a '#' to the end of its line is a comment.  Words are
+	// case folded the same way as tokens (see unicode.h), so a listed word
+	// with a capital accented letter still matches.  Returns false if the
+	// file can't be read.
+	bool Load(const char* filename);
+
+	bool Contains(std::string_view word) const
+	{
+		uint64_t hash = HashStopWord(word);
+		int index = m_slots[StopSlot(hash,
+			m_seeds[StopBucket(hash, m_bucketMask)], m_slotMask)];
+		return index >= 0 && m_words[index] == word;
+	}
+
+	size_t Size() const { return m_size; }
+
+private:
+	void Build();
+
+	// Either the built-in table or m_storage and the vectors below.
+	const std::string_view* m_words;
+	const uint32_t* m_seeds;
+	const int* m_slots;
+	size_t m_size;
+	size_t m_bucketMask;
+	size_t m_slotMask;
+
+	std::vector<std::string> m_storage;
+	std::vector<std::string_view> m_views;
+	std::vector<uint32_t> m_seedTable;
+	std::vector<int> m_slotTable;
+
+	// not copyable: the pointers above may point into the vectors
+	StopList(const StopList&);
+	StopList& operator=(const StopList&);
+};
+
+#endif
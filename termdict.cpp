@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+// termdict.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the term dictionary and document table.  See termdict.h.
+//
+// The dictionary is a linear probing hash table of (hash, id) slots.  The
+// full hash of each word is kept in its slot so that a probe only compares
+// word bytes when the hashes already match, and so that growing the table
+// never has to rehash a word.  The table is kept at most half full.
+///////////////////////////////////////////////////////////////////////////////
+#include "termdict.h"
+#include "writer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+using namespace std;
+
+const unsigned int TermDictionary::NO_TERM;
+
+static const size_t INITIAL_SLOTS = 1024;
+
+TermDictionary::TermDictionary()
+{
+	Slot empty = { 0, NO_TERM };
+	m_slots.assign(INITIAL_SLOTS, empty);
+}
+
+// 32 bit FNV-1a.  Words are short, so something this simple beats the more
+// elaborate hashes.
+unsigned int TermDictionary::Hash(const char* word, size_t length)
+{
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+	{
+		h ^= (unsigned char) word[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// Returns the index of the slot holding word, or of the empty slot where it
+// would go.
+size_t TermDictionary::Probe(unsigned int hash, const char* word,
+							 size_t length) const
+{
+	size_t mask = m_slots.size() - 1;
+	size_t i = hash & mask;
+	while (true)
+	{
+		const Slot& slot = m_slots[i];
+		if (slot.id == NO_TERM)
+			return i;
+		if (slot.hash == hash)
+		{
+			string_view term = m_terms[slot.id];
+			if (term.size() == length &&
+				memcmp(term.data(), word, length) == 0)
+				return i;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+void TermDictionary::Grow()
+{
+	Slot empty = { 0, NO_TERM };
+	m_slots.assign(m_slots.size() * 2, empty);
+
+	size_t mask = m_slots.size() - 1;
+	for (unsigned int id = 0; id < m_terms.size(); id++)
+	{
+		size_t i = m_hashes[id] & mask;
+		while (m_slots[i].id != NO_TERM)
+			i = (i + 1) & mask;
+		m_slots[i].hash = m_hashes[id];
+		m_slots[i].id = id;
+	}
+}
+
+unsigned int TermDictionary::Intern(const char* word, size_t length)
+{
+	unsigned int hash = Hash(word, length);
+	size_t i = Probe(hash, word, length);
+	if (m_slots[i].id != NO_TERM)
+		return m_slots[i].id;
+
+	unsigned int id = (unsigned int) m_terms.size();
+	m_terms.push_back(m_arena.Store(word, length));
+	m_hashes.push_back(hash);
+	m_slots[i].hash = hash;
+	m_slots[i].id = id;
+
+	if (m_terms.size() * 2 > m_slots.size())
+		Grow();
+	return id;
+}
+
+unsigned int TermDictionary::Find(const char* word, size_t length) const
+{
+	unsigned int hash = Hash(word, length);
+	return m_slots[Probe(hash, word, length)].id;
+}
+
+// Orders term ids by the bytes of the word they stand for.
+class TermLess
+{
+public:
+	TermLess(const vector<string_view>& terms) : m_terms(terms) {}
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		return m_terms[a] < m_terms[b];
+	}
+private:
+	const vector<string_view>& m_terms;
+};
+
+void TermDictionary::SortedOrder(vector<unsigned int>& order) const
+{
+	order.resize(m_terms.size());
+	for (unsigned int id = 0; id < order.size(); id++)
+		order[id] = id;
+	sort(order.begin(), order.end(), TermLess(m_terms));
+}
+
+bool TermDictionary::Load(const char* filename)
+{
+	ifstream in(filename);
+	if (!in || Size() != 0)
+		return false;
+
+	string line;
+	while (getline(in, line))
+	{
+		if (line.size() > 0 && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.size() == 0)
+			continue;
+
+		// "\t<dimension>\t<word>", and the dimensions have to count up from 0
+		size_t i = line[0] == '\t' ? 1 : 0;
+		size_t dimension = 0, digits = i;
+		while (i < line.size() && line[i] >= '0' && line[i] <= '9')
+			dimension = dimension * 10 + (line[i++] - '0');
+		if (i == digits || i >= line.size() || line[i] != '\t' ||
+			dimension != Size() || i + 1 == line.size())
+			return false;
+
+		if (Intern(line.data() + i + 1, line.size() - i - 1) != dimension)
+			return false;
+	}
+	return !in.bad();
+}
+
+bool TermDictionary::Save(const char* filename) const
+{
+	string temporary = string(filename) + ".tmp";
+	OutputFile out;
+	if (!out.Open(temporary))
+		return false;
+
+	for (unsigned int id = 0; id < m_terms.size(); id++)
+	{
+		out.Write('\t');
+		out.WriteNumber(id);
+		out.Write('\t');
+		out.Write(m_terms[id]);
+		out.Write('\n');
+	}
+	if (!out.Close() || rename(temporary.c_str(), filename) != 0)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+DocumentTable::DocumentTable()
+{
+	m_offsets.push_back(0);
+	m_dropped = 0;
+	m_firstResident = 0;
+	m_sparse = false;
+	m_sparseBits = 0;
+	m_documentsBegun = 0;
+}
+
+unsigned int DocumentTable::BeginDocument(string_view name)
+{
+	m_names.push_back(m_nameArena.Store(name));
+	m_documentsBegun++;
+	return (unsigned int) m_names.size() - 1;
+}
+
+// The slot of the document being built's position for term, which is 0 if
+// term hasn't occurred in it yet.
+inline unsigned int& DocumentTable::Position(unsigned int term)
+{
+	if (!m_sparse)
+	{
+		if (term >= m_position.size())
+			m_position.resize(max((size_t) term + 1, m_position.size() * 2), 
+				0);
+		return m_position[term];
+	}
+
+	// keep the table no more than half full
+	size_t terms = m_dropped + m_entries.size() - m_offsets.back();
+	if (2 * (terms + 1) > m_sparseSlots.size())
+		GrowSparse();
+
+	size_t document = m_documentsBegun;
+	size_t mask = m_sparseSlots.size() - 1;
+	size_t slot = (size_t) ((term * 0x9e3779b97f4a7c15ull) >> 
+		(64 - m_sparseBits));
+	while (m_sparseSlots[slot].document == document &&
+		m_sparseSlots[slot].term != term)
+		slot = (slot + 1) & mask;
+
+	SparseSlot& found = m_sparseSlots[slot];
+	if (found.document != document)
+	{
+		found.term = term;
+		found.position = 0;
+		found.document = document;
+	}
+	return found.position;
+}
+
+// Doubles the sparse table, putting back the terms of the document being
+// built.
+void DocumentTable::GrowSparse()
+{
+	SparseSlot empty = { 0, 0, 0 };
+	m_sparseBits = m_sparseBits == 0 ? 6 : m_sparseBits + 1;
+	m_sparseSlots.assign((size_t) 1 << m_sparseBits, empty);
+
+	size_t start = m_offsets.back() - m_dropped;
+	for (size_t i = start; i < m_entries.size(); i++)
+		Position(m_entries[i].term) = (unsigned int) (i - start + 1);
+}
+
+void DocumentTable::AddTerm(unsigned int term, unsigned int count)
+{
+	unsigned int& position = Position(term);
+	if (position == 0)
+	{
+		TermCount entry = { term, count };
+		m_entries.push_back(entry);
+		position = (unsigned int) (m_dropped + m_entries.size() - 
+			m_offsets.back());
+	}
+	else
+	{
+		m_entries[m_offsets.back() - m_dropped + position - 1].count += count;
+	}
+}
+
+void DocumentTable::EndDocument()
+{
+	// Clear out the positions this document used so the next one starts
+	// fresh, without touching the whole (vocabulary sized) array.
+	for (size_t i = m_offsets.back() - m_dropped; 
+		!m_sparse && i < m_entries.size(); i++)
+		m_position[m_entries[i].term] = 0;
+	m_offsets.push_back(m_dropped + m_entries.size());
+}
+
+void DocumentTable::DropFinished()
+{
+	// Keep the capacity: the vector will fill up to about the same size
+	// again before the next spill.
+	m_entries.erase(m_entries.begin(), 
+		m_entries.begin() + (m_offsets.back() - m_dropped));
+	m_dropped = m_offsets.back();
+	m_firstResident = (unsigned int) m_names.size();
+}
+
+void DocumentTable::Clear()
+{
+	m_names.clear();
+	m_nameArena.Clear();
+	m_offsets.assign(1, 0);
+	m_entries.clear();
+	m_dropped = 0;
+	m_firstResident = 0;
+}
+
+// Orders the entries of a sparse vector by term id.
+static bool TermCountLess(const TermCount& a, const TermCount& b)
+{
+	return a.term < b.term;
+}
+
+void DocumentTable::Renumber(const vector<unsigned int>& newTerm)
+{
+	for (size_t i = 0; i < m_entries.size(); i++)
+		m_entries[i].term = newTerm[m_entries[i].term];
+	Sort();
+}
+
+void DocumentTable::Sort()
+{
+	for (size_t doc = m_firstResident; doc < m_names.size(); doc++)
+	{
+		TermCount* begin = m_entries.data() + (m_offsets[doc] - m_dropped);
+		TermCount* end = m_entries.data() + (m_offsets[doc + 1] - m_dropped);
+		if (!is_sorted(begin, end, TermCountLess))
+			sort(begin, end, TermCountLess);
+	}
+}
@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+// termdict.h
+///////////////////////////////////////////////////////////////////////////////
+// The term dictionary and document table used to build the sparse datapoints.
+//
+// Every distinct word is interned exactly once into a TermDictionary, which
+// hands back a dense integer id for it (an open addressing hash table keyed
+// on the bytes of the word).  Each input document gets a dense document id in
+// a DocumentTable, and the table keeps that document's counts as a sparse
+// vector of (term id, count) pairs, in the order the terms were first seen in
+// the document.
+//
+// The words and the document names are kept in StringArenas rather than in
+// a std::string each.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef TERMDICT_H
+#define TERMDICT_H
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+
+// One non-zero entry of a document's sparse vector.
+struct TermCount
+{
+	unsigned int term;
+	unsigned int count;
+};
+
+class TermDictionary
+{
+public:
+	// Returned by Find() for words that have never been interned.
+	static const unsigned int NO_TERM = 0xffffffffu;
+
+	TermDictionary();
+
+	// Returns the id for word[0..length), adding it to the dictionary if it
+	// hasn't been seen before.  Ids are handed out densely starting at 0.
+	unsigned int Intern(const char* word, size_t length);
+
+	// Returns the id for word[0..length), or NO_TERM if it isn't present.
+	unsigned int Find(const char* word, size_t length) const;
+
+	size_t Size() const { return m_terms.size(); }
+	std::string_view Term(unsigned int id) const { return m_terms[id]; }
+
+	// Bytes allocated for the words.
+	size_t ArenaBytes() const { return m_arena.Allocated(); }
+
+	// Fills order with every term id, sorted by the bytes of the words (the
+	// same order the old map<string, ...> iterated in).
+	void SortedOrder(std::vector<unsigned int>& order) const;
+
+	// Reads a dictionary file written by Save() into an empty dictionary, so
+	// that each word's term id is its dimension in the file.  Returns false
+	// if the file can't be read or isn't a dictionary file.
+	bool Load(const char* filename);
+
+	// Writes every word to filename, a line per word in term id order, in the
+	// same "\t<dimension>\t<word>" form as the dimension mapping of an .edsf
+	// file.  The file is replaced in one rename(), so it is never left half
+	// written.  Returns false if it can't be written.
+	bool Save(const char* filename) const;
+
+	// The hash the dictionary uses for word[0..length).
+	static unsigned int Hash(const char* word, size_t length);
+
+private:
+	struct Slot
+	{
+		unsigned int hash;
+		unsigned int id;	// NO_TERM when the slot is empty
+	};
+
+	size_t Probe(unsigned int hash, const char* word, size_t length) const;
+	void Grow();
+
+	std::vector<Slot> m_slots;			// always a power of two in size
+	std::vector<std::string_view> m_terms;	// id -> word, in m_arena
+	std::vector<unsigned int> m_hashes;	// id -> hash of word, for rehashing
+	StringArena m_arena;
+
+	// not copyable: m_terms points into m_arena
+	TermDictionary(const TermDictionary&);
+	TermDictionary& operator=(const TermDictionary&);
+};
+
+class DocumentTable
+{
+public:
+	DocumentTable();
+
+	// Term ids will be spread over a huge range (hashed dimensions, see
+	// hashdims.h), so the terms of the document being built are found in a
+	// small hash table sized to it, rather than in an array with a slot for
+	// every term id up to the largest.  Call before the first document.
+	void SparseTerms() { m_sparse = true; }
+
+	// Starts a new document and returns its id.  Terms passed to AddTerm()
+	// are counted against it until EndDocument() is called.
+	unsigned int BeginDocument(std::string_view name);
+	void AddTerm(unsigned int term, unsigned int count = 1);
+	void EndDocument();
+
+	size_t Size() const { return m_names.size(); }
+	std::string_view Name(unsigned int doc) const { return m_names[doc]; }
+
+	// Bytes allocated for the names.
+	size_t ArenaBytes() const { return m_nameArena.Allocated(); }
+
+	// Replaces every term id t in every resident document with newTerm[t],
+	// and sorts each one's sparse vector by the new ids.  After this the
+	// vectors are no longer in the order their terms were first seen.
+	void Renumber(const std::vector<unsigned int>& newTerm);
+
+	// Sorts each resident document's sparse vector by term id, like 
+	// Renumber() but keeping the ids.
+	void Sort();
+
+	// The number of entries in a finished document's sparse vector, whether
+	// or not it is resident.
+	size_t Entries(unsigned int doc) const
+		{ return m_offsets[doc + 1] - m_offsets[doc]; }
+
+	// The sparse vector of a finished, resident document is
+	// [Begin(doc), End(doc)).
+	const TermCount* Begin(unsigned int doc) const
+		{ return m_entries.data() + (m_offsets[doc] - m_dropped); }
+	const TermCount* End(unsigned int doc) const
+		{ return m_entries.data() + (m_offsets[doc + 1] - m_dropped); }
+
+	// Frees the sparse vectors of every finished document, once they have
+	// been spilled somewhere else (see spill.h).  Documents before
+	// FirstResident() have no sparse vector in memory; their names and
+	// Entries() are kept.
+	void DropFinished();
+	unsigned int FirstResident() const { return m_firstResident; }
+
+	// Forgets every document, once they are all finished and written out,
+	// so that ids start from 0 again.
+	void Clear();
+
+	// The number of entries held in memory.
+	size_t ResidentEntries() const { return m_entries.size(); }
+
+private:
+	std::vector<std::string_view> m_names;	// in m_nameArena
+	StringArena m_nameArena;
+	std::vector<size_t> m_offsets;		// doc -> first entry, plus one past
+										// the end of the last document
+	std::vector<TermCount> m_entries;	// starting at entry m_dropped
+	size_t m_dropped;
+	unsigned int m_firstResident;
+
+	unsigned int& Position(unsigned int term);
+	void GrowSparse();
+
+	// For the document being built, the position+1 of each term's entry
+	// relative to the start of the document, or 0 if it hasn't occurred yet.
+	std::vector<unsigned int> m_position;
+
+	// With SparseTerms(), an open addressed table of the same instead.  A
+	// slot belongs to the document being built only if its document is
+	// m_documentsBegun, so slots never need clearing between documents.
+	struct SparseSlot
+	{
+		unsigned int term;
+		unsigned int position;
+		size_t document;
+	};
+	bool m_sparse;
+	std::vector<SparseSlot> m_sparseSlots;	// always a power of two in size
+	unsigned int m_sparseBits;
+	size_t m_documentsBegun;			// ever, even across Clear()
+
+	// not copyable: m_names points into m_nameArena
+	DocumentTable(const DocumentTable&);
+	DocumentTable& operator=(const DocumentTable&);
+};
+
+#endif
@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////
+// tokenizer.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the memory mapped tokenizer.  See tokenizer.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "tokenizer.h"
+#include "charclass.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+Tokenizer::Tokenizer()
+{
+	m_fd = -1;
+	m_ownsFd = false;
+	m_eof = true;
+	m_map = NULL;
+	m_mapLength = 0;
+	m_bytes = 0;
+	m_pos = m_end = NULL;
+	m_kernels = &GetCharKernels();
+	m_block = m_blockEnd = NULL;
+	m_spaces = m_other = 0;
+}
+
+Tokenizer::~Tokenizer()
+{
+	Close();
+}
+
+bool Tokenizer::Open(const char* filename)
+{
+	Close();
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+	{
+		void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED)
+		{
+			// we only ever walk forwards through the file once
+			madvise(map, info.st_size, MADV_SEQUENTIAL);
+			close(fd);
+
+			m_map = map;
+			m_mapLength = info.st_size;
+			m_bytes = m_mapLength;
+			m_pos = (const char*) map;
+			m_end = m_pos + m_mapLength;
+			m_kernels = &GetCharKernels();
+			return true;
+		}
+	}
+
+	Open(fd);
+	m_ownsFd = true;
+	return true;
+}
+
+void Tokenizer::Open(int fd)
+{
+	Close();
+
+	m_fd = fd;
+	m_ownsFd = false;
+	m_eof = false;
+	m_kernels = &GetCharKernels();
+	if (m_buffer.size() < BLOCK_SIZE)
+		m_buffer.resize(BLOCK_SIZE);
+	m_pos = m_end = m_buffer.data();
+}
+
+void Tokenizer::Open(const char* data, size_t length)
+{
+	Close();
+
+	// like a mapping, but with nothing to unmap
+	m_kernels = &GetCharKernels();
+	m_pos = data;
+	m_end = data + length;
+	m_bytes = length;
+}
+
+void Tokenizer::Close()
+{
+	if (m_map != NULL)
+		munmap(m_map, m_mapLength);
+	if (m_fd >= 0 && m_ownsFd)
+		close(m_fd);
+
+	m_fd = -1;
+	m_ownsFd = false;
+	m_eof = true;
+	m_map = NULL;
+	m_mapLength = 0;
+	m_bytes = 0;
+	m_pos = m_end = NULL;
+	m_block = m_blockEnd = NULL;
+}
+
+// Reads the next block of an input that isn't mapped, keeping the last keep
+// bytes of the current block (the start of a token that runs into the next
+// block) in front of it.  Returns false, leaving just the kept bytes, at the
+// end of the input.
+bool Tokenizer::Refill(size_t keep)
+{
+	if (m_map != NULL || m_eof)
+		return false;
+
+	memmove(m_buffer.data(), m_end - keep, keep);
+	m_block = m_blockEnd = NULL;
+	// a single token longer than the buffer; make room for the rest of it
+	if (keep == m_buffer.size())
+		m_buffer.resize(m_buffer.size() * 2);
+
+	char* data = m_buffer.data();
+	ssize_t got;
+	do
+	{
+		got = read(m_fd, data + keep, m_buffer.size() - keep);
+	} while (got < 0 && errno == EINTR);
+
+	m_pos = data;
+	m_end = data + keep;
+	if (got <= 0)
+	{
+		m_eof = true;
+		return false;
+	}
+	m_end += got;
+	m_bytes += got;
+	return true;
+}
+
+string_view Tokenizer::Peek(size_t want)
+{
+	if ((size_t) (m_end - m_pos) < want)
+		Refill(m_end - m_pos);
+
+	size_t length = m_end - m_pos;
+	return string_view(m_pos, length < want ? length : want);
+}
+
+// Classifies the block starting at p, unless p is already in the current
+// block.  p must be before m_end.
+inline void Tokenizer::Classify(const char* p)
+{
+	if (p >= m_block && p < m_blockEnd)
+		return;
+
+	m_block = p;
+	m_blockEnd = p + 64;
+	if (m_end - p >= 64)
+	{
+		m_kernels->ClassifyBlock(p, m_spaces, m_other);
+	}
+	else
+	{
+		// the kernels always look at 64 bytes, so pad the end of the input
+		// out with whitespace
+		char tail[64];
+		memset(tail, ' ', sizeof(tail));
+		memcpy(tail, p, m_end - p);
+		m_kernels->ClassifyBlock(tail, m_spaces, m_other);
+	}
+}
+
+bool Tokenizer::Next(string_view& token, bool& lower)
+{
+	// skip to the start of the next token
+	const char* p = m_pos;
+	while (true)
+	{
+		if (p >= m_end)
+		{
+			if (!Refill(0))
+				return false;
+			p = m_pos;
+			continue;
+		}
+
+		Classify(p);
+		uint64_t words = ~m_spaces >> (p - m_block);
+		if (words != 0)
+		{
+			// padding is whitespace, so this is always before m_end
+			p += __builtin_ctzll(words);
+			break;
+		}
+		p = m_blockEnd;
+	}
+
+	// and find its end
+	const char* start = p;
+	lower = true;
+	while (true)
+	{
+		if (p >= m_end)
+		{
+			p = m_end;
+			if (m_map != NULL || m_eof)
+				break;
+
+			// the token runs on into the next block of input
+			size_t length = p - start;
+			bool more = Refill(length);
+			start = m_pos;
+			p = start + length;
+			if (!more)
+				break;
+			continue;
+		}
+
+		Classify(p);
+		size_t offset = p - m_block;
+		uint64_t spaces = m_spaces >> offset;
+		uint64_t other = m_other >> offset;
+		if (spaces == 0)
+		{
+			if (other != 0)
+				lower = false;
+			p = m_blockEnd;
+			continue;
+		}
+
+		size_t length = __builtin_ctzll(spaces);
+		if ((other & (((uint64_t) 1 << length) - 1)) != 0)
+			lower = false;
+		p += length;
+		if (p < m_end)
+			break;
+	}
+
+	m_pos = p;
+	token = string_view(start, p - start);
+	return true;
+}
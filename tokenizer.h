@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// tokenizer.h
+///////////////////////////////////////////////////////////////////////////////
+// Splits input files into whitespace delimited tokens without copying them.
+//
+// Regular files are memory mapped and tokens are handed out as string_views
+// straight into the mapping.  Anything that can't be mapped (standard input,
+// pipes, empty files) is read in large blocks instead, and tokens point into
+// the block buffer.  Either way a token is only valid until the next call to
+// Next().
+//
+// Tokens are split exactly where "in >> str" on an istream would split them
+// (on ' ', '\t', '\n', '\v', '\f' and '\r').  Lower casing them and dealing
+// with punctuation is up to the TokenNormalizer (see normalize.h).
+//
+// The input is classified 64 bytes at a time by the vectorized kernels in 
+// charclass.h, which also tell Next() whether a token is already all lower
+// case letters, so that most tokens never need to be normalized.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stddef.h>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+class CharKernels;
+
+class Tokenizer
+{
+public:
+	Tokenizer();
+	~Tokenizer();
+
+	// Starts reading filename, mapping it if possible.  Returns false if it
+	// can't be opened, in which case the input is empty.
+	bool Open(const char* filename);
+
+	// Starts reading an already open descriptor (such as 0, for standard
+	// input) in blocks.  The descriptor isn't closed by Close().
+	void Open(int fd);
+
+	// Starts reading data[0..length), which the caller keeps hold of until
+	// it is done with the tokens.
+	void Open(const char* data, size_t length);
+
+	void Close();
+
+	// Sets token to the next token of the input, and lower to whether it is
+	// made up of nothing but lower case letters.  Returns false at the end
+	// of the input.
+	bool Next(std::string_view& token, bool& lower);
+
+	// Up to want bytes of the input Next() hasn't got to yet, without
+	// consuming them.  An input that is being read is read from once if
+	// there's less than that buffered, so there may be less even before
+	// the end of it.  Only valid until the next call to Next().
+	std::string_view Peek(size_t want);
+
+	// Bytes of input since Open(): all of a mapping, or what has been read.
+	size_t Bytes() const { return m_bytes; }
+
+private:
+	// Size of the blocks read when the input can't be mapped.
+	static const size_t BLOCK_SIZE = 1 << 20;
+
+	bool Refill(size_t keep);
+	void Classify(const char* p);
+
+	int m_fd;
+	bool m_ownsFd;
+	bool m_eof;
+
+	void* m_map;		// the mapping of the file, or NULL when reading
+	size_t m_mapLength;
+
+	std::vector<char> m_buffer;	// block buffer, reused from file to file
+	size_t m_bytes;
+
+	const char* m_pos;	// the unread part of the input
+	const char* m_end;
+
+	// The classified block of 64 bytes starting at m_block (see 
+	// CharKernels::ClassifyBlock).  Bytes past m_end count as whitespace.
+	const CharKernels* m_kernels;
+	const char* m_block;
+	const char* m_blockEnd;
+	uint64_t m_spaces;
+	uint64_t m_other;
+
+	// not copyable: it owns the mapping and descriptor
+	Tokenizer(const Tokenizer&);
+	Tokenizer& operator=(const Tokenizer&);
+};
+
+#endif
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// unicode.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the UTF-8 and code point helpers.  See unicode.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "unicode.h"
+#include "unicodetab.h"
+
+size_t DecodeUtf8(const char* text, size_t length, char32_t& c)
+{
+	const unsigned char* p = (const unsigned char*) text;
+	if (length == 0)
+		return 0;
+	if (p[0] < 0x80)
+	{
+		c = p[0];
+		return 1;
+	}
+
+	// the lead byte says how many continuation bytes follow, and the
+	// smallest code point that needs that many
+	size_t size;
+	char32_t code, least;
+	if (p[0] >= 0xc2 && p[0] < 0xe0)
+	{
+		size = 2;
+		code = p[0] & 0x1f;
+		least = 0x80;
+	}
+	else if (p[0] >= 0xe0 && p[0] < 0xf0)
+	{
+		size = 3;
+		code = p[0] & 0x0f;
+		least = 0x800;
+	}
+	else if (p[0] >= 0xf0 && p[0] < 0xf5)
+	{
+		size = 4;
+		code = p[0] & 0x07;
+		least = 0x10000;
+	}
+	else
+		return 0;
+
+	if (length < size)
+		return 0;
+	for (size_t i = 1; i < size; i++)
+	{
+		if ((p[i] & 0xc0) != 0x80)
+			return 0;
+		code = (code << 6) | (p[i] & 0x3f);
+	}
+	if (code < least || code > 0x10ffff || (code >= 0xd800 && code < 0xe000))
+		return 0;
+	c = code;
+	return size;
+}
+
+size_t EncodeUtf8(char32_t c, char* out)
+{
+	if (c < 0x80)
+	{
+		out[0] = (char) c;
+		return 1;
+	}
+	if (c < 0x800)
+	{
+		out[0] = (char) (0xc0 | (c >> 6));
+		out[1] = (char) (0x80 | (c & 0x3f));
+		return 2;
+	}
+	if (c < 0x10000)
+	{
+		out[0] = (char) (0xe0 | (c >> 12));
+		out[1] = (char) (0x80 | ((c >> 6) & 0x3f));
+		out[2] = (char) (0x80 | (c & 0x3f));
+		return 3;
+	}
+	out[0] = (char) (0xf0 | (c >> 18));
+	out[1] = (char) (0x80 | ((c >> 12) & 0x3f));
+	out[2] = (char) (0x80 | ((c >> 6) & 0x3f));
+	out[3] = (char) (0x80 | (c & 0x3f));
+	return 4;
+}
+
+UnicodeClass FoldCodePoint(char32_t c, char32_t& folded)
+{
+	if (c > 0x10ffff)
+	{
+		folded = c;
+		return UNICODE_OTHER;
+	}
+
+	unsigned int row = UNICODE_BLOCKS[c / UNICODE_BLOCK];
+	const UnicodeProperties& properties = UNICODE_PROPERTIES[
+		UNICODE_ROWS[row * UNICODE_BLOCK + c % UNICODE_BLOCK]];
+	folded = c + properties.fold;
+	return properties.cls;
+}
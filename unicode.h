@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// unicode.h
+///////////////////////////////////////////////////////////////////////////////
+// Just enough Unicode to normalize UTF-8 words: decoding and encoding UTF-8,
+// and which code points are letters (or digits) and what they case fold to.
+//
+// Letters are the code points of general category L (letters of any kind)
+// or M (combining marks, so accents written as separate code points, and
+// the vowel signs of many scripts, stay part of their words).  Digits are
+// category Nd, and spaces are the code points with the White_Space property.
+// Case folding is Unicode's simple case folding, which maps each code point
+// to a single one, so "A" folds to "a" and a capital sigma and a final sigma
+// both fold to a small sigma, but sharp s stays as it is.
+//
+// The properties come from tables generated by mkunicodetab.py (see
+// unicodetab.h): a code point's block of 128 picks a row of a table of
+// property numbers, and the property number says what the code point is
+// and how far it is from what it folds to.  A lookup is two loads.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef UNICODE_H
+#define UNICODE_H
+
+#include <stddef.h>
+
+enum UnicodeClass
+{
+	UNICODE_OTHER,		// punctuation, symbols and the like
+	UNICODE_LETTER,
+	UNICODE_DIGIT,
+	UNICODE_SPACE		// such as no-break, thin and ideographic spaces
+};
+
+// Decodes the UTF-8 character at the start of text[0..length) into c and
+// returns how many bytes it took.  Returns 0, leaving c alone, if it isn't a
+// valid UTF-8 sequence (or length is 0).  Overlong forms and surrogates are
+// invalid.
+size_t DecodeUtf8(const char* text, size_t length, char32_t& c);
+
+// Writes c to out in UTF-8 and returns how many bytes it took (1 to 4).
+size_t EncodeUtf8(char32_t c, char* out);
+
+// What c is, and (in folded) what it case folds to.  Only letters fold;
+// anything else folds to itself.
+UnicodeClass FoldCodePoint(char32_t c, char32_t& folded);
+
+#endif
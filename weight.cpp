@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// weight.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the weightings.  See weight.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "weight.h"
+#include "docfreq.h"
+#include "spill.h"
+
+#include <math.h>
+#include <string.h>
+using namespace std;
+
+static const float BM25_K1 = 1.2f;
+static const float BM25_B = 0.75f;
+
+bool ParseWeighting(const char* name, Weighting& weighting)
+{
+	if (strcmp(name, "count") == 0)
+		weighting = WEIGHT_COUNT;
+	else if (strcmp(name, "tf") == 0)
+		weighting = WEIGHT_TF;
+	else if (strcmp(name, "tfidf") == 0)
+		weighting = WEIGHT_TFIDF;
+	else if (strcmp(name, "bm25") == 0)
+		weighting = WEIGHT_BM25;
+	else if (strcmp(name, "l2") == 0)
+		weighting = WEIGHT_L2;
+	else
+		return false;
+	return true;
+}
+
+bool NeedsFrequencies(Weighting weighting)
+{
+	return weighting == WEIGHT_TFIDF || weighting == WEIGHT_BM25 ||
+		weighting == WEIGHT_L2;
+}
+
+// The inverse document frequency of a term that occurs in df of the given
+// number of documents.
+float Weigher::Idf(Weighting weighting, double df, size_t documents)
+{
+	if (weighting == WEIGHT_BM25)
+		return (float) log(1 + (documents - df + 0.5) / (df + 0.5));
+	return (float) (log((1.0 + documents) / (1 + df)) + 1);
+}
+
+inline float Weigher::Idf(unsigned int dimension) const
+{
+	if (!m_sparse)
+		return m_idf[dimension];
+	unordered_map<unsigned int, float>::const_iterator i =
+		m_sparseIdf.find(dimension);
+	return i != m_sparseIdf.end() ? i->second : 0;
+}
+
+Weigher::Weigher(Weighting weighting, const DocumentFrequencies& frequencies,
+				 const vector<unsigned int>& order, size_t documents)
+{
+	m_weighting = weighting;
+	m_sparse = false;
+	m_averageLength = 1;
+	if (!NeedsFrequencies(weighting))
+		return;
+
+	m_idf.resize(order.size());
+	for (size_t d = 0; d < order.size(); d++)
+		m_idf[d] = Idf(weighting, frequencies.Frequency(order[d]), documents);
+}
+
+Weigher::Weigher(Weighting weighting, const DocumentFrequencies& frequencies,
+				 size_t documents)
+{
+	m_weighting = weighting;
+	m_sparse = true;
+	m_averageLength = 1;
+	if (!NeedsFrequencies(weighting))
+		return;
+
+	vector<unsigned int> dimensions;
+	frequencies.Counted(dimensions);
+	m_sparseIdf.reserve(dimensions.size());
+	for (size_t i = 0; i < dimensions.size(); i++)
+	{
+		m_sparseIdf[dimensions[i]] = Idf(weighting, 
+			frequencies.Frequency(dimensions[i]), documents);
+	}
+}
+
+bool Weigher::Measure(DocumentReader& documents)
+{
+	if (m_weighting != WEIGHT_BM25)
+		return true;
+
+	double words = 0;
+	size_t count = 0;
+	const TermCount* begin;
+	const TermCount* end;
+	if (!documents.Rewind())
+		return false;
+	while (documents.Next(begin, end))
+	{
+		for (const TermCount* entry = begin; entry != end; entry++)
+			words += entry->count;
+		count++;
+	}
+	if (count < documents.Documents().Size())
+		return false;
+
+	m_averageLength = count > 0 && words > 0 ? words / count : 1;
+	return true;
+}
+
+void Weigher::Weigh(const TermCount* begin, const TermCount* end,
+					vector<float>& weights) const
+{
+	size_t n = end - begin;
+	weights.resize(n);
+	float* w = weights.data();
+
+	float length = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		w[i] = (float) begin[i].count;
+		length += w[i];
+	}
+
+	switch (m_weighting)
+	{
+	case WEIGHT_COUNT:
+		break;
+
+	case WEIGHT_TF:
+		for (size_t i = 0; i < n; i++)
+			w[i] /= length;
+		break;
+
+	case WEIGHT_TFIDF:
+	case WEIGHT_L2:
+		for (size_t i = 0; i < n; i++)
+			w[i] *= Idf(begin[i].term);
+		if (m_weighting == WEIGHT_L2 && n > 0)
+		{
+			double sum = 0;
+			for (size_t i = 0; i < n; i++)
+				sum += (double) w[i] * w[i];
+			float scale = (float) (1 / sqrt(sum));
+			for (size_t i = 0; i < n; i++)
+				w[i] *= scale;
+		}
+		break;
+
+	case WEIGHT_BM25:
+	{
+		float k = BM25_K1 * (1 - BM25_B +
+			BM25_B * (float) (length / m_averageLength));
+		for (size_t i = 0; i < n; i++)
+			w[i] = Idf(begin[i].term) * w[i] * (BM25_K1 + 1) / (w[i] + k);
+		break;
+	}
+	}
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// weight.h
+///////////////////////////////////////////////////////////////////////////////
+// Turning the counts of a document's sparse vector into weights (--weight)
+// as the output is written:
+//
+//   count   the raw counts, written as integers (the default)
+//   tf      each count divided by the number of words in the document
+//   tfidf   each count times the term's inverse document frequency,
+//           ln((1 + documents) / (1 + df)) + 1
+//   bm25    Okapi BM25 with k1 = 1.2 and b = 0.75, using the inverse
+//           document frequency ln(1 + (documents - df + 0.5) / (df + 0.5))
+//   l2      tfidf, with each document's vector scaled to unit length
+//
+// The words of a document are the ones that are written out, so pruned
+// words (see docfreq.h) don't count towards its length.  The inverse
+// document frequency of every dimension is worked out once, up front, and
+// weighing a document is then a few passes over its sparse vector.  Hashed
+// dimensions (--hash-dims) are far too many for that, so only those that
+// occur in some document get one, kept in a hash table.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef WEIGHT_H
+#define WEIGHT_H
+
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+#include "termdict.h"
+
+class DocumentFrequencies;
+class DocumentReader;
+
+enum Weighting
+{
+	WEIGHT_COUNT,
+	WEIGHT_TF,
+	WEIGHT_TFIDF,
+	WEIGHT_BM25,
+	WEIGHT_L2
+};
+
+// Parses the name of a weighting ("count", "tf", "tfidf", "bm25" or "l2").
+// Returns false if it isn't one.
+bool ParseWeighting(const char* name, Weighting& weighting);
+
+// Whether a weighting needs document frequencies.
+bool NeedsFrequencies(Weighting weighting);
+
+class Weigher
+{
+public:
+	// Sets up weighing documents whose sparse vectors hold dimensions, where
+	// dimension d is term order[d], out of the given number of documents.
+	Weigher(Weighting weighting, const DocumentFrequencies& frequencies,
+		const std::vector<unsigned int>& order, size_t documents);
+
+	// Sets up weighing documents whose sparse vectors hold hashed 
+	// dimensions, whose frequencies were counted sparsely.
+	Weigher(Weighting weighting, const DocumentFrequencies& frequencies,
+		size_t documents);
+
+	// BM25 needs the average length of a document, which takes a pass over
+	// every document first.  Returns false if they can't be read.
+	bool Measure(DocumentReader& documents);
+
+	// Fills weights with the weight of each entry of [begin, end).
+	void Weigh(const TermCount* begin, const TermCount* end,
+		std::vector<float>& weights) const;
+
+private:
+	static float Idf(Weighting weighting, double df, size_t documents);
+	float Idf(unsigned int dimension) const;
+
+	Weighting m_weighting;
+	bool m_sparse;
+	std::vector<float> m_idf;		// dimension -> inverse document frequency
+	std::unordered_map<unsigned int, float> m_sparseIdf;
+	double m_averageLength;
+};
+
+#endif
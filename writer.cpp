@@ -0,0 +1,253 @@
+///////////////////////////////////////////////////////////////////////////////
+// writer.cpp
+///////////////////////////////////////////////////////////////////////////////
+// Implementation of the buffered output files and the background writer.
+// See writer.h.
+///////////////////////////////////////////////////////////////////////////////
+#include "writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+using namespace std;
+
+// Writes all of data to fd, however many write() calls it takes.
+static bool WriteAll(int fd, const char* data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(fd, data, length);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += written;
+		length -= written;
+	}
+	return true;
+}
+
+static int Create(const string& filename)
+{
+	return open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+}
+
+OutputFile::OutputFile(size_t bufferSize)
+{
+	m_fd = -1;
+	m_writer = NULL;
+	m_failed = false;
+	m_size = 0;
+	m_bufferSize = bufferSize;
+	m_written = 0;
+}
+
+OutputFile::~OutputFile()
+{
+	if (m_fd >= 0 || m_writer != NULL)
+		Close();
+}
+
+bool OutputFile::Open(const string& filename, AsyncWriter* writer)
+{
+	m_name = filename;
+	m_writer = writer;
+	m_failed = false;
+	m_size = 0;
+	if (m_buffer.size() < m_bufferSize)
+		m_buffer.resize(m_bufferSize);
+
+	if (writer != NULL)
+		return true;
+
+	m_fd = Create(filename);
+	if (m_fd < 0)
+		m_failed = true;
+	return !m_failed;
+}
+
+bool OutputFile::Flush()
+{
+	if (m_writer != NULL)
+		return !m_failed;
+	if (m_fd >= 0 && !WriteAll(m_fd, m_buffer.data(), m_size))
+		m_failed = true;
+	else if (m_fd >= 0)
+		m_written += m_size;
+	m_size = 0;
+	return !m_failed;
+}
+
+// Makes room for length more bytes: by writing out the buffer when writing
+// directly, or by growing it when the whole file has to be kept for the
+// AsyncWriter.
+void OutputFile::MakeRoom(size_t length)
+{
+	if (m_writer == NULL)
+	{
+		Flush();
+		if (length <= m_buffer.size())
+			return;
+	}
+	m_buffer.resize(max(m_buffer.size() * 2, m_size + length));
+}
+
+bool OutputFile::Close()
+{
+	if (m_writer != NULL)
+	{
+		m_written += m_size;
+		m_writer->Submit(m_name, m_buffer, m_size);
+		m_writer = NULL;
+	}
+	else
+	{
+		Flush();
+		if (m_fd >= 0 && close(m_fd) != 0)
+			m_failed = true;
+		m_fd = -1;
+	}
+	m_size = 0;
+	return !m_failed;
+}
+
+void OutputFile::WriteNumber(unsigned long long n)
+{
+	static const char DIGITS[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+	// written backwards from the end, two digits at a time
+	char text[20];
+	char* p = text + sizeof(text);
+	while (n >= 100)
+	{
+		unsigned int pair = (unsigned int) (n % 100);
+		n /= 100;
+		p -= 2;
+		memcpy(p, DIGITS + pair * 2, 2);
+	}
+	if (n >= 10)
+	{
+		p -= 2;
+		memcpy(p, DIGITS + n * 2, 2);
+	}
+	else
+	{
+		*--p = (char) ('0' + n);
+	}
+	Write(p, text + sizeof(text) - p);
+}
+
+void OutputFile::WriteFloat(float x)
+{
+	char text[32];
+	to_chars_result result = to_chars(text, text + sizeof(text), x);
+	Write(text, result.ptr - text);
+}
+
+AsyncWriter::AsyncWriter(unsigned int threads, size_t maxQueued)
+{
+	m_queued = 0;
+	m_maxQueued = maxQueued;
+	m_writing = 0;
+	m_stopping = false;
+	for (unsigned int i = 0; i < max(threads, 1u); i++)
+		m_threads.push_back(thread(&AsyncWriter::Run, this));
+}
+
+AsyncWriter::~AsyncWriter()
+{
+	{
+		lock_guard<mutex> lock(m_lock);
+		m_stopping = true;
+	}
+	m_ready.notify_all();
+	for (size_t i = 0; i < m_threads.size(); i++)
+		m_threads[i].join();
+}
+
+void AsyncWriter::Submit(const string& filename, vector<char>& contents,
+						 size_t size)
+{
+	unique_lock<mutex> lock(m_lock);
+
+	// don't let the queue grow without bound if the disk can't keep up, but
+	// always accept a job when nothing else is queued
+	while (m_queued > 0 && m_queued + size > m_maxQueued)
+		m_done.wait(lock);
+
+	m_queue.push_back(Job());
+	Job& job = m_queue.back();
+	job.filename = filename;
+	job.contents.swap(contents);
+	job.size = size;
+	m_queued += size;
+
+	if (!m_spare.empty())
+	{
+		contents.swap(m_spare.back());
+		m_spare.pop_back();
+	}
+	lock.unlock();
+	m_ready.notify_one();
+}
+
+void AsyncWriter::Run()
+{
+	unique_lock<mutex> lock(m_lock);
+	while (true)
+	{
+		while (m_queue.empty() && !m_stopping)
+			m_ready.wait(lock);
+		if (m_queue.empty())
+			return;
+
+		Job job;
+		job.filename.swap(m_queue.front().filename);
+		job.contents.swap(m_queue.front().contents);
+		job.size = m_queue.front().size;
+		m_queue.pop_front();
+		m_writing++;
+		lock.unlock();
+
+		int fd = Create(job.filename);
+		bool written = fd >= 0 && WriteAll(fd, job.contents.data(), job.size);
+		if (fd >= 0 && close(fd) != 0)
+			written = false;
+
+		lock.lock();
+		if (!written && m_failed.empty())
+			m_failed = job.filename;
+		m_queued -= job.size;
+		m_writing--;
+		// keep a few buffers around so OutputFile doesn't have to allocate
+		if (m_spare.size() < 2 * m_threads.size() + 2)
+		{
+			m_spare.push_back(vector<char>());
+			m_spare.back().swap(job.contents);
+		}
+		m_done.notify_all();
+	}
+}
+
+bool AsyncWriter::Finish(string& failed)
+{
+	unique_lock<mutex> lock(m_lock);
+	while (!m_queue.empty() || m_writing > 0)
+		m_done.wait(lock);
+	failed = m_failed;
+	return m_failed.empty();
+}
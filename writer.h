@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// writer.h
+///////////////////////////////////////////////////////////////////////////////
+// Buffered output for the .edsf/.edmf and .spasms files.
+//
+// An OutputFile collects everything written to it in a large user space
+// buffer and only hands it to the operating system when the buffer is full
+// or the file is closed, so a .spasms file of any reasonable size takes one
+// write() no matter how many lines it has.  Numbers are formatted by hand
+// rather than through iostreams.
+//
+// An OutputFile opened with an AsyncWriter keeps the whole file in memory
+// and, when it is closed, passes it to the writer's background threads to
+// create and write, so that writing hundreds of thousands of small files
+// overlaps with formatting them instead of waiting on open(), write() and
+// close() for each one in turn.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class AsyncWriter;
+
+class OutputFile
+{
+public:
+	OutputFile(size_t bufferSize = 1 << 20);
+	~OutputFile();
+
+	// Creates (or truncates) filename.  If writer isn't NULL, nothing is
+	// actually written until Close(), when the writer takes over.  Returns
+	// false if the file can't be created.
+	bool Open(const std::string& filename, AsyncWriter* writer = NULL);
+
+	// Writes out whatever is buffered and closes the file.  Returns false if
+	// anything written to the file since it was opened failed.
+	bool Close();
+
+	void Write(const char* data, size_t length)
+	{
+		if (m_size + length > m_buffer.size())
+			MakeRoom(length);
+		memcpy(m_buffer.data() + m_size, data, length);
+		m_size += length;
+	}
+
+	void Write(std::string_view text) { Write(text.data(), text.size()); }
+
+	void Write(char c)
+	{
+		if (m_size == m_buffer.size())
+			MakeRoom(1);
+		m_buffer[m_size++] = c;
+	}
+
+	void WriteNumber(unsigned long long n);
+
+	// Writes the shortest decimal that reads back as exactly x.
+	void WriteFloat(float x);
+
+	// Hands whatever is buffered to the operating system now, rather than
+	// when the buffer fills up.  Does nothing with an AsyncWriter.  Returns
+	// false if anything written so far failed.
+	bool Flush();
+
+	const std::string& Name() const { return m_name; }
+
+	// Bytes written to every file this has been opened as.
+	unsigned long long Written() const { return m_written; }
+
+private:
+	void MakeRoom(size_t length);
+
+	std::string m_name;
+	int m_fd;
+	AsyncWriter* m_writer;
+	bool m_failed;
+
+	std::vector<char> m_buffer;	// m_buffer.size() is the capacity
+	size_t m_size;				// how much of it is in use
+	size_t m_bufferSize;
+	unsigned long long m_written;
+
+	// not copyable: it owns the descriptor
+	OutputFile(const OutputFile&);
+	OutputFile& operator=(const OutputFile&);
+};
+
+class AsyncWriter
+{
+public:
+	// Writes files with the given number of threads.  Submit() waits while
+	// more than maxQueued bytes are waiting to be written.
+	AsyncWriter(unsigned int threads, size_t maxQueued = 64 << 20);
+
+	// Finishes writing everything submitted.
+	~AsyncWriter();
+
+	// Queues contents to be written to filename, taking the contents and
+	// leaving contents with an empty buffer to reuse.
+	void Submit(const std::string& filename, std::vector<char>& contents,
+		size_t size);
+
+	// Waits for everything submitted so far to be written.  Returns false if
+	// any file couldn't be written, and sets failed to the first of them.
+	bool Finish(std::string& failed);
+
+private:
+	class Job
+	{
+	public:
+		std::string filename;
+		std::vector<char> contents;
+		size_t size;
+	};
+
+	void Run();
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_lock;
+	std::condition_variable m_ready;	// a job was queued, or stopping
+	std::condition_variable m_done;		// a job finished
+	std::deque<Job> m_queue;
+	std::vector<std::vector<char> > m_spare;	// written buffers, for reuse
+	size_t m_queued;		// bytes waiting in m_queue
+	size_t m_maxQueued;
+	size_t m_writing;		// jobs taken off the queue but not yet written
+	bool m_stopping;
+	std::string m_failed;	// the first file that couldn't be written
+
+	AsyncWriter(const AsyncWriter&);
+	AsyncWriter& operator=(const AsyncWriter&);
+};
+
+#endif